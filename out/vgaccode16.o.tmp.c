@@ -0,0 +1,22 @@
+#include "src/output.c"
+ #include "src/string.c"
+ #include "src/hw/pci.c"
+ #include "src/hw/serialio.c"
+ #include "vgasrc/vgainit.c"
+ #include "vgasrc/vgabios.c"
+ #include "vgasrc/vgafb.c"
+ #include "vgasrc/swcursor.c"
+ #include "vgasrc/vgafonts.c"
+ #include "vgasrc/vbe.c"
+ #include "vgasrc/stdvga.c"
+ #include "vgasrc/stdvgamodes.c"
+ #include "vgasrc/stdvgaio.c"
+ #include "vgasrc/clext.c"
+ #include "vgasrc/svgamodes.c"
+ #include "vgasrc/atiext.c"
+ #include "vgasrc/bochsvga.c"
+ #include "vgasrc/geodevga.c"
+ #include "src/fw/coreboot.c"
+ #include "vgasrc/cbvga.c"
+ #include "vgasrc/bochsdisplay.c"
+ #include "vgasrc/ramfb.c"
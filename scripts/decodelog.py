@@ -0,0 +1,186 @@
+#!/usr/bin/env python
+# Convert a SeaBIOS debug log containing binary records to text.
+#
+# This file may be distributed under the terms of the GNU GPLv3 license.
+
+# Usage:
+#   scripts/decodelog.py [-o out/] [-t] capture.log
+#
+# The capture is the raw output of the debug port (for example from
+# QEMU's "-chardev file,id=seabios,path=capture.log -device
+# isa-debugcon,iobase=0x402,chardev=seabios") or of the serial port
+# of a build with CONFIG_DEBUG_BINARY.  The out/ directory must be the
+# one of the build that produced the log - format strings are read
+# from its bios.bin.
+#
+# Each record has the following layout (all values little endian):
+#   u8 magic (0x1e), u8 datalen, u32 fmt, u64 tsc, u32 thread,
+#   u8 data[datalen]
+# where 'fmt' is the link address of the format string and 'data'
+# holds the arguments in format order: 32bit values (two for "%ll"
+# conversions, the bdf for "%pP") and null terminated strings.
+
+import sys, struct, optparse
+
+RECORD_MAGIC = 0x1e
+HEADER = '<BBIQI'
+HEADER_SIZE = struct.calcsize(HEADER)
+BIOS_END = 0x100000
+
+class Image:
+    def __init__(self, filename):
+        self.data = open(filename, 'rb').read()
+        self.start = BIOS_END - len(self.data)
+    def getstring(self, addr):
+        pos = addr - self.start
+        if pos < 0 or pos >= len(self.data):
+            return None
+        end = self.data.find(b'\0', pos)
+        if end < 0:
+            end = len(self.data)
+        return self.data[pos:end].decode('latin-1')
+
+class Args:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+        self.truncated = False
+    def get32(self):
+        if self.pos + 4 > len(self.data):
+            self.truncated = True
+            return 0
+        val, = struct.unpack_from('<I', self.data, self.pos)
+        self.pos += 4
+        return val
+    def getstring(self):
+        end = self.data.find(b'\0', self.pos)
+        if end < 0:
+            self.truncated = True
+            end = len(self.data)
+        s = self.data[self.pos:end].decode('latin-1')
+        self.pos = end + 1
+        return s
+
+def prettyhex(val, width, padchar, uc):
+    s = '%x' % (val,)
+    if uc:
+        s = s.upper()
+    return padchar * (width - len(s)) + s
+
+# Format a message in the same way as bvprintf() in src/output.c
+def format(fmt, args):
+    out = []
+    i = 0
+    while i < len(fmt):
+        c = fmt[i]
+        if c != '%':
+            out.append(c)
+            i += 1
+            continue
+        n = i + 1
+        width = 0
+        padchar = ' '
+        while n < len(fmt) and fmt[n].isdigit():
+            if not width and fmt[n] == '0':
+                padchar = '0'
+            else:
+                width = width * 10 + int(fmt[n])
+            n += 1
+        is64 = False
+        if fmt[n:n+1] == 'l':
+            n += 1
+        if fmt[n:n+1] == 'l':
+            is64 = True
+            n += 1
+        c = fmt[n:n+1]
+        if c == '%':
+            out.append('%')
+        elif c == 'd' or c == 'u':
+            val = args.get32()
+            if is64:
+                args.get32()
+            if c == 'd' and val & 0x80000000:
+                out.append('-')
+                val = 0x100000000 - val
+            out.append('%d' % (val,))
+        elif c == 'p':
+            val = args.get32()
+            if fmt[n+1:n+2] == 'P':
+                out.append('%02x:%02x.%x' % (
+                    val >> 8, (val >> 3) & 0x1f, val & 7))
+                n += 1
+            else:
+                out.append('0x%08x' % (val,))
+        elif c == 'x' or c == 'X':
+            uc = c == 'X'
+            val = args.get32()
+            upper = 0
+            if is64:
+                upper = args.get32()
+            if upper:
+                out.append(prettyhex(upper, width - 8, padchar, uc))
+                out.append(prettyhex(val, 8, '0', uc))
+            else:
+                out.append(prettyhex(val, width, padchar, uc))
+        elif c == 'c':
+            out.append(chr(args.get32() & 0xff))
+        elif c == '.':
+            if fmt[n+1:n+2] == 's':
+                n += 1
+                out.append(args.getstring())
+        elif c == 's':
+            out.append(args.getstring())
+        else:
+            out.append('%')
+            n = i
+        i = n + 1
+    return ''.join(out)
+
+def decode(data, image, showtime, outfile):
+    pos = 0
+    basetsc = None
+    while pos < len(data):
+        rec = data.find(bytes([RECORD_MAGIC]), pos)
+        if rec < 0:
+            rec = len(data)
+        outfile.write(data[pos:rec].decode('latin-1').replace('\r', ''))
+        if rec + HEADER_SIZE > len(data):
+            break
+        magic, datalen, fmtaddr, tsc, thread = struct.unpack_from(
+            HEADER, data, rec)
+        start = rec + HEADER_SIZE
+        pos = start + datalen
+        fmt = image.getstring(fmtaddr)
+        if fmt is None:
+            outfile.write("<bad record fmt=%08x>\n" % (fmtaddr,))
+            continue
+        if basetsc is None:
+            basetsc = tsc
+        prefix = ''
+        if showtime:
+            prefix = '[%12d] ' % (tsc - basetsc,)
+        if thread:
+            prefix += '|%08x| ' % (thread,)
+        args = Args(data[start:pos])
+        msg = format(fmt, args)
+        if args.truncated:
+            msg = msg.rstrip('\n') + ' <truncated>\n'
+        outfile.write(prefix + msg)
+
+def main():
+    opts = optparse.OptionParser("%prog [options] <capture>")
+    opts.add_option("-o", "--outdir", dest="outdir", default="out/",
+                    help="directory containing bios.bin")
+    opts.add_option("-t", "--time", action="store_true", dest="time",
+                    default=False,
+                    help="prefix messages with tsc cycles since first record")
+    options, args = opts.parse_args()
+    if len(args) != 1:
+        opts.error("Incorrect number of arguments")
+
+    image = Image(options.outdir + 'bios.bin')
+    data = open(args[0], 'rb').read()
+    decode(data, image, options.time, sys.stdout)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+# Create a block compressed floppy image for the SeaBIOS ramdisk.
+#
+# This file may be distributed under the terms of the GNU GPLv3 license.
+
+# Usage:
+#   scripts/mkramdisk.py [-b blocksize] floppy.img floppy.img.lzb
+#
+# This script requires python3 (for its lzma module).
+#
+# The output should be added to the "floppyimg/" directory of CBFS
+# (or fw_cfg) with its ".lzb" suffix.  Unlike an image with a ".lzma"
+# suffix, it is not decompressed as a whole during POST - each block
+# is decompressed when it is read.
+#
+# File layout (all values little endian):
+#   u32 magic ("LZB1"), u32 disksize, u32 blocksize,
+#   u8 lzma_props[5], u8 pad[3],
+#   u32 offsets[count + 1], block data...
+# where count is disksize/blocksize (rounded up) and offsets[i] is the
+# file offset of block i.  Each block is a raw lzma stream (without
+# the usual 13 byte header) decoded with lzma_props - unless its data
+# is exactly as large as the uncompressed block, in which case it is
+# stored as is.
+
+import sys, struct, lzma, optparse
+
+LZB_MAGIC = b'LZB1'
+SECTOR_SIZE = 512
+MAX_BLOCKSIZE = 64*1024
+HEADER = '<4sII5s3x'
+
+def compress_block(data, blocksize):
+    filters = [{'id': lzma.FILTER_LZMA1, 'preset': 9 | lzma.PRESET_EXTREME,
+                'dict_size': max(blocksize, 4096)}]
+    out = lzma.compress(data, format=lzma.FORMAT_ALONE, filters=filters)
+    return out[:5], out[13:]
+
+def main():
+    opts = optparse.OptionParser("%prog [options] <image> <output>")
+    opts.add_option("-b", "--blocksize", type="int", dest="blocksize",
+                    default=32*1024, help="uncompressed block size")
+    options, args = opts.parse_args()
+    if len(args) != 2:
+        opts.error("Incorrect number of arguments")
+    bs = options.blocksize
+    if bs <= 0 or bs % SECTOR_SIZE or bs > MAX_BLOCKSIZE:
+        opts.error("Block size must be a multiple of %d up to %d"
+                   % (SECTOR_SIZE, MAX_BLOCKSIZE))
+
+    image = open(args[0], 'rb').read()
+    count = (len(image) + bs - 1) // bs
+    props = None
+    blocks = []
+    for i in range(count):
+        data = image[i*bs:(i+1)*bs]
+        p, comp = compress_block(data, bs)
+        props = p
+        if len(comp) >= len(data):
+            comp = data
+        blocks.append(comp)
+
+    offset = struct.calcsize(HEADER) + (count + 1) * 4
+    offsets = []
+    for comp in blocks:
+        offsets.append(offset)
+        offset += len(comp)
+    offsets.append(offset)
+
+    out = open(args[1], 'wb')
+    out.write(struct.pack(HEADER, LZB_MAGIC, len(image), bs,
+                          props or b'\0' * 5))
+    out.write(struct.pack('<%dI' % (count + 1,), *offsets))
+    for comp in blocks:
+        out.write(comp)
+    out.close()
+    sys.stdout.write("%d bytes in %d blocks compressed to %d bytes\n"
+                     % (len(image), count, offset))
+
+if __name__ == '__main__':
+    main()
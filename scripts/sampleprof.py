@@ -0,0 +1,121 @@
+#!/usr/bin/env python
+# Symbolize the histogram produced by the SeaBIOS sampling profiler.
+#
+# This file may be distributed under the terms of the GNU GPLv3 license.
+
+# Usage:
+#   scripts/sampleprof.py [-o out/] seabios.log
+#   scripts/sampleprof.py [-o out/] --raw histogram.bin
+#
+# The log should contain the "sampleprof:" lines written just prior
+# to boot.  A raw histogram (of runtime samples) may be dumped from a
+# running guest using the address reported at startup, for example
+# with the QEMU monitor command "pmemsave <addr> 3072 histogram.bin".
+
+import sys, re, struct, subprocess, optparse
+
+SEG_BIOS = 0xf000
+
+re_sample = re.compile(
+    r'sampleprof: (?P<seg>[0-9a-f]{4}):(?P<addr>[0-9a-f]{8}) (?P<count>\d+)')
+re_dropped = re.compile(r'sampleprof: dropped (?P<count>\d+)')
+
+# Load the sorted symbol table of an object file.
+def loadsyms(objfile):
+    syms = []
+    try:
+        out = subprocess.check_output(['nm', '-n', objfile])
+    except (OSError, subprocess.CalledProcessError):
+        sys.stderr.write("Unable to read symbols from %s\n" % (objfile,))
+        return syms
+    for line in out.decode().splitlines():
+        parts = line.split()
+        if len(parts) != 3 or parts[1] not in 'tTwW':
+            continue
+        syms.append((int(parts[0], 16), parts[2]))
+    return syms
+
+# Find the symbol containing an address.
+def lookup(syms, addr):
+    lo, hi = 0, len(syms)
+    while lo < hi:
+        mid = (lo + hi) // 2
+        if syms[mid][0] <= addr:
+            lo = mid + 1
+        else:
+            hi = mid
+    if not lo:
+        return None
+    return syms[lo-1][1]
+
+def readlog(filename):
+    samples = []
+    dropped = 0
+    for line in open(filename, 'r', errors='replace'):
+        m = re_sample.search(line)
+        if m is not None:
+            samples.append((int(m.group('seg'), 16), int(m.group('addr'), 16)
+                            , int(m.group('count'))))
+            continue
+        m = re_dropped.search(line)
+        if m is not None:
+            dropped += int(m.group('count'))
+    return samples, dropped
+
+def readraw(filename):
+    data = open(filename, 'rb').read()
+    samples = []
+    for pos in range(0, len(data) - 11, 12):
+        addr, seg, pad, count = struct.unpack_from('<IHHI', data, pos)
+        if count:
+            samples.append((seg, addr, count))
+    return samples, 0
+
+def main():
+    opts = optparse.OptionParser("%prog [options] <logfile>")
+    opts.add_option("-o", "--outdir", dest="outdir", default="out/",
+                    help="directory containing rom.o and rom16.o")
+    opts.add_option("--raw", action="store_true", dest="raw", default=False,
+                    help="input is a raw dump of the histogram")
+    options, args = opts.parse_args()
+    if len(args) != 1:
+        opts.error("Incorrect number of arguments")
+    if options.raw:
+        samples, dropped = readraw(args[0])
+    else:
+        samples, dropped = readlog(args[0])
+
+    syms32 = loadsyms(options.outdir + 'rom.o')
+    syms16 = loadsyms(options.outdir + 'rom16.o')
+
+    # Group samples by function.
+    funcs = {}
+    total = dropped
+    for seg, addr, count in samples:
+        total += count
+        if not seg:
+            name = lookup(syms32, addr)
+            kind = '32bit'
+        elif seg == SEG_BIOS:
+            name = lookup(syms16, addr)
+            kind = '16bit'
+        else:
+            name = None
+            kind = 'external'
+        if name is None:
+            name = '%04x:%08x' % (seg, addr)
+        funcs[(kind, name)] = funcs.get((kind, name), 0) + count
+    if not total:
+        sys.stdout.write("No samples found\n")
+        return
+
+    sys.stdout.write("%10s %6s  %-8s  %s\n" % ("ms", "%", "mode", "location"))
+    for (kind, name), count in sorted(funcs.items(), key=lambda x: -x[1]):
+        sys.stdout.write("%10d %5.1f%%  %-8s  %s\n" % (
+            count, count * 100.0 / total, kind, name))
+    if dropped:
+        sys.stdout.write("%10d %5.1f%%  (histogram full)\n" % (
+            dropped, dropped * 100.0 / total))
+
+if __name__ == '__main__':
+    main()
@@ -591,6 +591,8 @@ process_op_32(struct disk_op_s *op)
         return pvscsi_process_op(op);
     case DTYPE_NVME:
         return nvme_process_op(op);
+    case DTYPE_RAMDISK_LZB:
+        return ramdisk_lzb_process_op(op);
     default:
         return process_op_both(op);
     }
@@ -69,6 +69,7 @@ struct drive_s {
 #define DTYPE_ATA          0x20
 #define DTYPE_ATA_ATAPI    0x21
 #define DTYPE_RAMDISK      0x30
+#define DTYPE_RAMDISK_LZB  0x31
 #define DTYPE_CDEMU        0x40
 #define DTYPE_AHCI         0x50
 #define DTYPE_AHCI_ATAPI   0x51
@@ -8,6 +8,7 @@
 #include "bregs.h" // struct bregs
 #include "config.h" // CONFIG_*
 #include "farptr.h" // FLATPTR_TO_SEG
+#include "fw/smp.h" // smp_job_run
 #include "malloc.h" // free
 #include "output.h" // dprintf
 #include "romfile.h" // romfile_loadfile
@@ -92,6 +93,22 @@ find_videomode(struct vbe_info *vesa_info, struct vbe_mode_info *mode_info
     }
 }
 
+struct jpeg_show_s {
+    struct jpeg_decdata *jpeg;
+    u8 *picture;
+    int width, height, depth, bytes_per_line;
+    int ret;
+};
+
+// Picture decompression job (may run on an idle AP).
+static void
+jpeg_show_job(void *data)
+{
+    struct jpeg_show_s *js = data;
+    js->ret = jpeg_show(js->jpeg, js->picture, js->width, js->height
+                        , js->depth, js->bytes_per_line);
+}
+
 static int BootsplashActive;
 
 void
@@ -202,8 +219,12 @@ enable_bootsplash(void)
 
     if (type == 0) {
         dprintf(5, "Decompressing bootsplash.jpg\n");
-        ret = jpeg_show(jpeg, picture, width, height, depth,
-                            mode_info->bytes_per_scanline);
+        struct jpeg_show_s js = {
+            .jpeg = jpeg, .picture = picture, .width = width
+            , .height = height, .depth = depth
+            , .bytes_per_line = mode_info->bytes_per_scanline };
+        smp_job_run(jpeg_show_job, &js);
+        ret = js.ret;
         if (ret) {
             dprintf(1, "jpeg_show failed with return code %d...\n", ret);
             goto done;
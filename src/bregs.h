@@ -34,6 +34,16 @@ struct bregs {
     u16 flags;
 } PACKED;
 
+// Registers saved on the extra stack by irqentry_extrastack - a
+// pointer to this is passed to hardware irq handlers.
+struct irqregs {
+    u16 ds;
+    u16 es;
+    u32 edi, esi, ebp, ebx, edx, ecx, eax;
+    u32 esp;
+    u16 ss;
+} PACKED;
+
 
 /****************************************************************
  * Helper functions
@@ -300,9 +300,10 @@ clock_update(void)
 
 // INT 08h System Timer ISR Entry Point
 void VISIBLE16
-handle_08(void)
+handle_08(struct irqregs *regs)
 {
     debug_isr(DEBUG_ISR_08);
+    sampleprof_irq(regs);
     clock_update();
 
     // chain to user timer tick INT #0x1c
@@ -455,7 +456,7 @@ handle_1583(struct bregs *regs)
 
 // int70h: IRQ8 - CMOS RTC
 void VISIBLE16
-handle_70(void)
+handle_70(struct irqregs *regs)
 {
     if (!CONFIG_RTC_TIMER)
         return;
@@ -479,6 +480,7 @@ handle_70(void)
 
     // Handle Periodic Interrupt.
 
+    sampleprof_irq(regs);
     check_preempt();
 
     if (!GET_BDA(rtc_wait_flag))
@@ -40,6 +40,7 @@
 #define BUILD_BIOS_ADDR           0xf0000
 #define BUILD_BIOS_SIZE           0x10000
 #define BUILD_EXTRA_STACK_SIZE    0x800
+#define BUILD_AP_STACK_SIZE       0x400
 #define BUILD_SMM_INIT_ADDR       0x30000
 #define BUILD_SMM_ADDR            0xa0000
 
@@ -733,6 +733,7 @@ void VISIBLE16
 handle_40(struct bregs *regs)
 {
     debug_enter(regs, DEBUG_HDL_40);
+    sampleprof_enter();
     handle_legacy_disk(regs, regs->dl);
 }
 
@@ -741,6 +742,7 @@ void VISIBLE16
 handle_13(struct bregs *regs)
 {
     debug_enter(regs, DEBUG_HDL_13);
+    sampleprof_enter();
     u8 extdrive = regs->dl;
 
     if (CONFIG_CDROM_EMU) {
@@ -9,7 +9,7 @@
 #include "config.h" // CONFIG_*
 #include "e820map.h" // e820_add
 #include "hw/pcidevice.h" // pci_probe_devices
-#include "lzmadecode.h" // LzmaDecode
+#include "lzmadecode.h" // LzmaDecode, LzmaDecodeStep
 #include "malloc.h" // free
 #include "output.h" // dprintf
 #include "paravirt.h" // PlatformRunningOn
@@ -216,19 +216,35 @@ fail:
     return;
 }
 
-void coreboot_debug_putc(char c)
+// Append a chunk of debug output to the cbmem console.  The text is
+// copied in (at most) two pieces around the end of the ring, and the
+// cursor is updated once.
+void coreboot_debug_putbuf(const char *buf, int len)
 {
     if (!CONFIG_DEBUG_COREBOOT)
         return;
-    if (!cbcon)
+    if (!cbcon || len <= 0)
         return;
+    u32 size = cbcon->size;
     u32 cursor = cbcon->cursor & CBMC_CURSOR_MASK;
     u32 flags = cbcon->cursor & ~CBMC_CURSOR_MASK;
-    if (cursor >= cbcon->size)
+    if (cursor >= size)
         return; // Old coreboot version with legacy overflow mechanism.
-    cbcon->body[cursor++] = c;
-    if (cursor >= cbcon->size) {
-        cursor = 0;
+    if (len > size) {
+        // Only the tail of the chunk fits in the ring.
+        buf += len - size;
+        cursor = (cursor + len - size) % size;
+        len = size;
+        flags |= CBMC_OVERFLOW;
+    }
+    u32 first = size - cursor;
+    if (len < first) {
+        memcpy(&cbcon->body[cursor], buf, len);
+        cursor += len;
+    } else {
+        memcpy(&cbcon->body[cursor], buf, first);
+        memcpy(cbcon->body, buf + first, len - first);
+        cursor = len - first;
         flags |= CBMC_OVERFLOW;
     }
     cbcon->cursor = flags | cursor;
@@ -278,38 +294,129 @@ coreboot_platform_setup(void)
  * ulzma
  ****************************************************************/
 
-// Uncompress data in flash to an area of memory.
+struct ulzma_s {
+    CLzmaDecoderState state;
+    const u8 *src;
+    u8 *dst;
+    u32 srclen, dstlen;
+    int ret;
+};
+
+// Parse the header of lzma data and return the size of the
+// probability table needed to decode it.
 static int
-ulzma(u8 *dst, u32 maxlen, const u8 *src, u32 srclen)
+ulzma_probsize(struct ulzma_s *u, u8 *dst, u32 maxlen, const u8 *src, u32 srclen)
 {
     dprintf(3, "Uncompressing data %d@%p to %d@%p\n", srclen, src, maxlen, dst);
-    CLzmaDecoderState state;
-    int ret = LzmaDecodeProperties(&state.Properties, src, LZMA_PROPERTIES_SIZE);
+    if (srclen < LZMA_PROPERTIES_SIZE + 8) {
+        dprintf(1, "LzmaDecode data too short (%d)\n", srclen);
+        return -1;
+    }
+    int ret = LzmaDecodeProperties(&u->state.Properties, src, LZMA_PROPERTIES_SIZE);
     if (ret != LZMA_RESULT_OK) {
         dprintf(1, "LzmaDecodeProperties error - %d\n", ret);
         return -1;
     }
+    u32 dstlen = *(u32*)(src + LZMA_PROPERTIES_SIZE);
+    if (dstlen > maxlen) {
+        dprintf(1, "LzmaDecode too large (max %d need %d)\n", maxlen, dstlen);
+        return -1;
+    }
+    u->src = src + LZMA_PROPERTIES_SIZE + 8;
+    u->srclen = srclen - LZMA_PROPERTIES_SIZE - 8;
+    u->dst = dst;
+    u->dstlen = dstlen;
+    u->ret = 0;
+    return LzmaGetNumProbs(&u->state.Properties) * sizeof(CProb);
+}
+
+// Start decoding using the given probability table.
+static int
+ulzma_begin(struct ulzma_s *u, CProb *probs)
+{
+    u->state.Probs = probs;
+    u->ret = LzmaDecoderInit(&u->state, u->src, u->srclen);
+    return u->ret ? -1 : 0;
+}
+
+// Decode up to 'count' more bytes.  Returns 1 if there is more to
+// decode, 0 when done, and -1 on error.
+static int
+ulzma_step(struct ulzma_s *u, u32 count)
+{
+    if (u->ret)
+        return -1;
+    u32 limit = u->dstlen;
+    if (count < limit - u->state.NowPos)
+        limit = u->state.NowPos + count;
+    u->ret = LzmaDecodeStep(&u->state, u->dst, limit);
+    if (u->ret)
+        return -1;
+    return (u->state.NowPos < u->dstlen
+            && u->state.RemainLen != kLzmaStreamWasFinishedId);
+}
+
+static int
+ulzma_finish(struct ulzma_s *u)
+{
+    if (u->ret) {
+        dprintf(1, "LzmaDecode returned %d\n", u->ret);
+        return -1;
+    }
+    return u->dstlen;
+}
+
+// Uncompress data in flash to an area of memory.
+static int
+ulzma(u8 *dst, u32 maxlen, const u8 *src, u32 srclen)
+{
+    struct ulzma_s u;
+    int need = ulzma_probsize(&u, dst, maxlen, src, srclen);
+    if (need < 0)
+        return -1;
+    // Memory can't be allocated here (this is used when booting a
+    // payload), so only the default lc/lp settings are supported.
     u8 scratch[15980];
-    int need = (LzmaGetNumProbs(&state.Properties) * sizeof(CProb));
     if (need > sizeof(scratch)) {
         dprintf(1, "LzmaDecode need %d have %d\n", need, (unsigned int)sizeof(scratch));
         return -1;
     }
-    state.Probs = (CProb *)scratch;
+    if (!ulzma_begin(&u, (CProb *)scratch))
+        ulzma_step(&u, u.dstlen);
+    return ulzma_finish(&u);
+}
 
-    u32 dstlen = *(u32*)(src + LZMA_PROPERTIES_SIZE);
-    if (dstlen > maxlen) {
-        dprintf(1, "LzmaDecode too large (max %d need %d)\n", maxlen, dstlen);
+// Output decoded between yields.
+#define ULZMA_CHUNK (64*1024)
+
+// Uncompress data during POST.  The probability table is allocated
+// (so any lc/lp setting works), and the data is decoded in chunks so
+// that other threads continue to run.
+static int
+ulzma_post(u8 *dst, u32 maxlen, const u8 *src, u32 srclen)
+{
+    struct ulzma_s u;
+    int need = ulzma_probsize(&u, dst, maxlen, src, srclen);
+    if (need < 0)
         return -1;
-    }
-    u32 inProcessed, outProcessed;
-    ret = LzmaDecode(&state, src + LZMA_PROPERTIES_SIZE + 8, srclen
-                     , &inProcessed, dst, dstlen, &outProcessed);
-    if (ret) {
-        dprintf(1, "LzmaDecode returned %d\n", ret);
+    CProb *probs = malloc_tmphigh(need);
+    if (!probs) {
+        warn_noalloc();
         return -1;
     }
-    return dstlen;
+    u32 start = timer_calc(0);
+    if (!ulzma_begin(&u, probs))
+        while (ulzma_step(&u, ULZMA_CHUNK) > 0)
+            yield();
+    free(probs);
+    int ret = ulzma_finish(&u);
+    if (ret < 0)
+        return ret;
+    u32 usec = timer_elapsed_usec(start);
+    dprintf(3, "Uncompressed %d bytes to %d in %d us (%d KiB/s)\n"
+            , srclen, ret, usec
+            , usec >= 1000 ? ret / 1024 * 1000 / (usec / 1000) : 0);
+    return ret;
 }
 
 
@@ -345,9 +452,26 @@ struct cbfs_romfile_s {
     struct romfile_s file;
     struct cbfs_file *fhdr;
     void *data;
+    void *cache;
     u32 rawsize, flags;
 };
 
+// Files up to this size are read into ram along with their header.
+#define CBFS_CACHE_MAX 4096
+
+static u32 CBFSReadCount, CBFSReadBytes, CBFSReadUsec;
+
+// Read from the memory mapped flash (which may be slow).
+static void
+cbfs_read(void *dst, const void *src, u32 len)
+{
+    u32 start = timer_calc(0);
+    iomemcpy(dst, src, len);
+    CBFSReadCount++;
+    CBFSReadBytes += len;
+    CBFSReadUsec += timer_elapsed_usec(start);
+}
+
 // Copy a file to memory (uncompressing if necessary)
 static int
 cbfs_copyfile(struct romfile_s *file, void *dst, u32 maxlen)
@@ -358,18 +482,22 @@ cbfs_copyfile(struct romfile_s *file, void *dst, u32 maxlen)
     struct cbfs_romfile_s *cfile;
     cfile = container_of(file, struct cbfs_romfile_s, file);
     u32 size = cfile->rawsize;
-    void *src = cfile->data;
+    void *src = cfile->cache ?: cfile->data;
     if (cfile->flags) {
-        // Compressed - copy to temp ram and uncompress it.
-        void *temp = malloc_tmphigh(size);
+        // Compressed - copy to temp ram (if not cached) and uncompress it.
+        void *temp = cfile->cache;
         if (!temp) {
-            warn_noalloc();
-            return -1;
+            temp = malloc_tmphigh(size);
+            if (!temp) {
+                warn_noalloc();
+                return -1;
+            }
+            cbfs_read(temp, src, size);
         }
-        iomemcpy(temp, src, size);
-        int ret = ulzma(dst, maxlen, temp, size);
+        int ret = ulzma_post(dst, maxlen, temp, size);
         yield();
-        free(temp);
+        if (temp != cfile->cache)
+            free(temp);
         return ret;
     }
 
@@ -379,7 +507,10 @@ cbfs_copyfile(struct romfile_s *file, void *dst, u32 maxlen)
         warn_noalloc();
         return -1;
     }
-    iomemcpy(dst, src, size);
+    if (cfile->cache)
+        memcpy(dst, src, size);
+    else
+        cbfs_read(dst, src, size);
     return size;
 }
 
@@ -444,14 +575,20 @@ coreboot_cbfs_init(void)
     }
     dprintf(1, "Found CBFS header at %p\n", hdr);
 
+    // Build the file list in ram.  Each header is read from flash
+    // only once, and the data of small files is read along with it.
     u32 romsize = be32_to_cpu(hdr->romsize);
     u32 romstart = CONFIG_CBFS_LOCATION - romsize;
+    u32 align = be32_to_cpu(hdr->align);
     struct cbfs_file *fhdr = (void*)romstart + be32_to_cpu(hdr->offset);
+    int count = 0, cached = 0;
     for (;;) {
         if ((u32)fhdr - romstart > romsize)
             break;
-        u64 magic = fhdr->magic;
-        if (magic != CBFS_FILE_MAGIC)
+        struct cbfs_file fh;
+        cbfs_read(&fh, fhdr, sizeof(fh));
+        u32 offset = be32_to_cpu(fh.offset);
+        if (fh.magic != CBFS_FILE_MAGIC || offset < sizeof(fh))
             break;
         struct cbfs_romfile_s *cfile = malloc_tmp(sizeof(*cfile));
         if (!cfile) {
@@ -459,27 +596,54 @@ coreboot_cbfs_init(void)
             break;
         }
         memset(cfile, 0, sizeof(*cfile));
-        strtcpy(cfile->file.name, fhdr->filename, sizeof(cfile->file.name));
-        cfile->file.size = cfile->rawsize = be32_to_cpu(fhdr->len);
+        cfile->file.size = cfile->rawsize = be32_to_cpu(fh.len);
         cfile->fhdr = fhdr;
         cfile->file.copy = cbfs_copyfile;
-        cfile->data = (void*)fhdr + be32_to_cpu(fhdr->offset);
+        cfile->data = (void*)fhdr + offset;
+        u32 namelen = offset - sizeof(fh);
+        if (namelen > sizeof(cfile->file.name) - 1)
+            namelen = sizeof(cfile->file.name) - 1;
+        u8 *buf = NULL;
+        if (cfile->rawsize <= CBFS_CACHE_MAX)
+            buf = malloc_tmphigh(offset - sizeof(fh) + cfile->rawsize);
+        if (buf) {
+            cbfs_read(buf, fhdr->filename, offset - sizeof(fh) + cfile->rawsize);
+            memcpy(cfile->file.name, buf, namelen);
+            cfile->cache = buf + offset - sizeof(fh);
+            cached++;
+        } else {
+            cbfs_read(cfile->file.name, fhdr->filename, namelen);
+        }
         int len = strlen(cfile->file.name);
         if (len > 5 && strcmp(&cfile->file.name[len-5], ".lzma") == 0) {
             // Using compression.
             cfile->flags = 1;
             cfile->file.name[len-5] = '\0';
-            cfile->file.size = *(u32*)(cfile->data + LZMA_PROPERTIES_SIZE);
+            if (cfile->cache)
+                cfile->file.size = *(u32*)(cfile->cache + LZMA_PROPERTIES_SIZE);
+            else
+                cbfs_read(&cfile->file.size, cfile->data + LZMA_PROPERTIES_SIZE
+                          , sizeof(cfile->file.size));
         }
         romfile_add(&cfile->file);
+        count++;
 
-        fhdr = (void*)ALIGN((u32)cfile->data + cfile->rawsize
-                            , be32_to_cpu(hdr->align));
+        fhdr = (void*)ALIGN((u32)cfile->data + cfile->rawsize, align);
     }
+    dprintf(3, "CBFS: %d files (%d cached in ram)\n", count, cached);
 
     process_links_file();
 }
 
+void
+cbfs_report(void)
+{
+    if (!CONFIG_COREBOOT_FLASH || !CBFSReadCount)
+        return;
+    dprintf(3, "CBFS: %d flash reads, %d bytes in %d us\n"
+            , CBFSReadCount, CBFSReadBytes, CBFSReadUsec);
+}
+
 struct cbfs_payload_segment {
     u32 type;
     u32 compression;
@@ -188,6 +188,7 @@ handle_csm_0002(struct bregs *regs)
     mathcp_setup();
     timer_setup();
     clock_setup();
+    settle_setup();
     device_hardware_setup();
     wait_threads();
     interactive_bootmenu();
@@ -0,0 +1,124 @@
+// Post-mortem debug log kept in reserved memory.
+//
+// This file may be distributed under the terms of the GNU LGPLv3 license.
+
+#include "biosvar.h" // GET_GLOBAL
+#include "config.h" // CONFIG_DEBUG_LOGRING
+#include "e820map.h" // e820_list
+#include "malloc.h" // memalign_high
+#include "output.h" // dprintf
+#include "paravirt.h" // qemu_cfg_write_file, RamSize
+#include "romfile.h" // romfile_find
+#include "string.h" // memmove
+#include "util.h" // logring_setup
+#include "x86.h" // PAGE_SIZE
+
+// The ring has the same layout as the coreboot cbmem console (after
+// a magic value), so existing tools that read that format can be used
+// on a dump of it.
+struct logring_s {
+    u32 magic;
+    u32 size;
+    u32 cursor;
+    u8 body[0];
+} PACKED;
+
+#define LOGRING_MAGIC 0x474f4c53 // "SLOG"
+#define LOGRING_CURSOR_MASK ((1 << 28) - 1)
+#define LOGRING_OVERFLOW (1 << 31)
+
+#define LOGRING_FILE "etc/seabios-logring"
+
+struct logring_s *LogRing VARFSEG;
+
+// Append debug output to the ring.
+void
+logring_putbuf(const char *buf, int len)
+{
+    if (!CONFIG_DEBUG_LOGRING)
+        return;
+    struct logring_s *ring = GET_GLOBAL(LogRing);
+    if (!ring)
+        return;
+    u32 cursor = ring->cursor & LOGRING_CURSOR_MASK;
+    u32 flags = ring->cursor & ~LOGRING_CURSOR_MASK;
+    while (len--) {
+        ring->body[cursor++] = *buf++;
+        if (cursor >= ring->size) {
+            cursor = 0;
+            flags |= LOGRING_OVERFLOW;
+        }
+    }
+    ring->cursor = flags | cursor;
+}
+
+// Check that a range is within memory.  The ring was allocated from
+// the high zone, which is already marked reserved at this point, so
+// reserved ranges below the top of ram are accepted too.
+static int
+logring_is_ram(u64 start, u64 size)
+{
+    int i;
+    for (i=0; i<e820_count; i++) {
+        struct e820entry *e = &e820_list[i];
+        if (start < e->start || start + size > e->start + e->size)
+            continue;
+        if (e->type == E820_RAM)
+            return 1;
+        if (e->type == E820_RESERVED && start + size <= RamSize)
+            return 1;
+        return 0;
+    }
+    return 0;
+}
+
+// Return the ring of the previous boot (if this is a reboot and the
+// host still has its address).
+static struct logring_s *
+logring_find_old(struct romfile_s *file, u32 size)
+{
+    u64 addr = 0;
+    if (!file || file->size != sizeof(addr)
+        || file->copy(file, &addr, sizeof(addr)) != sizeof(addr))
+        return NULL;
+    if (!addr || addr > 0xffffffff - sizeof(struct logring_s) - size
+        || !logring_is_ram(addr, sizeof(struct logring_s) + size))
+        return NULL;
+    struct logring_s *old = (void*)(u32)addr;
+    if (old->magic != LOGRING_MAGIC || old->size != size
+        || (old->cursor & LOGRING_CURSOR_MASK) >= size)
+        return NULL;
+    return old;
+}
+
+void
+logring_setup(void)
+{
+    if (!CONFIG_DEBUG_LOGRING)
+        return;
+    u32 size = CONFIG_DEBUG_LOGRING_SIZE * 1024;
+    struct romfile_s *file = romfile_find(LOGRING_FILE);
+    struct logring_s *old = logring_find_old(file, size);
+    struct logring_s *ring = memalign_high(PAGE_SIZE, sizeof(*ring) + size);
+    if (!ring) {
+        warn_noalloc();
+        return;
+    }
+    if (old) {
+        // Keep the output from before the reboot.
+        memmove(ring, old, sizeof(*ring) + size);
+    } else {
+        memset(ring, 0, sizeof(*ring) + size);
+        ring->magic = LOGRING_MAGIC;
+        ring->size = size;
+    }
+    LogRing = ring;
+
+    // Tell the host where to find the ring.
+    if (CONFIG_QEMU && file && file->size == sizeof(u64)) {
+        u64 addr = (u32)ring;
+        qemu_cfg_write_file(&addr, file, 0, sizeof(addr));
+    }
+    dprintf(1, "Debug log ring at %p (size %d)%s\n"
+            , ring, size, old ? " - kept previous boot" : "");
+}
@@ -130,40 +130,66 @@ int LzmaDecodeProperties(CLzmaProperties *propsRes, const unsigned char *propsDa
   return LZMA_RESULT_OK;
 }
 
-#define kLzmaStreamWasFinishedId (-1)
-
-int LzmaDecode(CLzmaDecoderState *vs,
-    const unsigned char *inStream, SizeT inSize, SizeT *inSizeProcessed,
-    unsigned char *outStream, SizeT outSize, SizeT *outSizeProcessed)
+int LzmaDecoderInit(CLzmaDecoderState *vs,
+    const unsigned char *inStream, SizeT inSize)
 {
   CProb *p = vs->Probs;
-  SizeT nowPos = 0;
-  Byte previousByte = 0;
-  UInt32 posStateMask = (1 << (vs->Properties.pb)) - 1;
-  UInt32 literalPosMask = (1 << (vs->Properties.lp)) - 1;
-  int lc = vs->Properties.lc;
-
-
-  int state = 0;
-  UInt32 rep0 = 1, rep1 = 1, rep2 = 1, rep3 = 1;
-  int len = 0;
   const Byte *Buffer;
   const Byte *BufferLim;
   UInt32 Range;
   UInt32 Code;
 
-  *inSizeProcessed = 0;
-  *outSizeProcessed = 0;
-
   {
     UInt32 i;
-    UInt32 numProbs = Literal + ((UInt32)LZMA_LIT_SIZE << (lc + vs->Properties.lp));
+    UInt32 numProbs = LzmaGetNumProbs(&vs->Properties);
     for (i = 0; i < numProbs; i++)
       p[i] = kBitModelTotal >> 1;
   }
-  
+
   RC_INIT(inStream, inSize);
 
+  vs->Buffer = Buffer;
+  vs->BufferLim = BufferLim;
+  vs->Range = Range;
+  vs->Code = Code;
+  vs->NowPos = 0;
+  vs->Reps[0] = vs->Reps[1] = vs->Reps[2] = vs->Reps[3] = 1;
+  vs->State = 0;
+  vs->RemainLen = 0;
+  vs->PreviousByte = 0;
+  return LZMA_RESULT_OK;
+}
+
+int LzmaDecodeStep(CLzmaDecoderState *vs,
+    unsigned char *outStream, SizeT outSize)
+{
+  CProb *p = vs->Probs;
+  SizeT nowPos = vs->NowPos;
+  Byte previousByte = vs->PreviousByte;
+  UInt32 posStateMask = (1 << (vs->Properties.pb)) - 1;
+  UInt32 literalPosMask = (1 << (vs->Properties.lp)) - 1;
+  int lc = vs->Properties.lc;
+
+
+  int state = vs->State;
+  UInt32 rep0 = vs->Reps[0], rep1 = vs->Reps[1];
+  UInt32 rep2 = vs->Reps[2], rep3 = vs->Reps[3];
+  int len = vs->RemainLen;
+  const Byte *Buffer = vs->Buffer;
+  const Byte *BufferLim = vs->BufferLim;
+  UInt32 Range = vs->Range;
+  UInt32 Code = vs->Code;
+
+  if (len == kLzmaStreamWasFinishedId)
+    return LZMA_RESULT_OK;
+
+  /* finish a match that was cut off by the previous output limit */
+  while (len != 0 && nowPos < outSize)
+  {
+    previousByte = outStream[nowPos - rep0];
+    len--;
+    outStream[nowPos++] = previousByte;
+  }
 
   while(nowPos < outSize)
   {
@@ -391,8 +417,37 @@ int LzmaDecode(CLzmaDecoderState *vs,
   }
   RC_NORMALIZE;
 
+  vs->Buffer = Buffer;
+  vs->Range = Range;
+  vs->Code = Code;
+  vs->NowPos = nowPos;
+  vs->Reps[0] = rep0;
+  vs->Reps[1] = rep1;
+  vs->Reps[2] = rep2;
+  vs->Reps[3] = rep3;
+  vs->State = state;
+  vs->RemainLen = len;
+  vs->PreviousByte = previousByte;
+  return LZMA_RESULT_OK;
+}
+
+int LzmaDecode(CLzmaDecoderState *vs,
+    const unsigned char *inStream, SizeT inSize, SizeT *inSizeProcessed,
+    unsigned char *outStream, SizeT outSize, SizeT *outSizeProcessed)
+{
+  int res;
+
+  *inSizeProcessed = 0;
+  *outSizeProcessed = 0;
+
+  res = LzmaDecoderInit(vs, inStream, inSize);
+  if (res != LZMA_RESULT_OK)
+    return res;
+  res = LzmaDecodeStep(vs, outStream, outSize);
+  if (res != LZMA_RESULT_OK)
+    return res;
 
-  *inSizeProcessed = (SizeT)(Buffer - inStream);
-  *outSizeProcessed = nowPos;
+  *inSizeProcessed = (SizeT)(vs->Buffer - inStream);
+  *outSizeProcessed = vs->NowPos;
   return LZMA_RESULT_OK;
 }
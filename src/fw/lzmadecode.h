@@ -50,13 +50,23 @@ int LzmaDecodeProperties(CLzmaProperties *propsRes, const unsigned char *propsDa
 #define LzmaGetNumProbs(Properties) (LZMA_BASE_SIZE + (LZMA_LIT_SIZE << ((Properties)->lc + (Properties)->lp)))
 
 #define kLzmaNeedInitId (-2)
+#define kLzmaStreamWasFinishedId (-1)
 
 typedef struct _CLzmaDecoderState
 {
   CLzmaProperties Properties;
   CProb *Probs;
 
-
+  /* Decoder position (for LzmaDecoderInit / LzmaDecodeStep) */
+  const Byte *Buffer;
+  const Byte *BufferLim;
+  UInt32 Range;
+  UInt32 Code;
+  SizeT NowPos;
+  UInt32 Reps[4];
+  int State;
+  int RemainLen;
+  Byte PreviousByte;
 } CLzmaDecoderState;
 
 
@@ -64,4 +74,13 @@ int LzmaDecode(CLzmaDecoderState *vs,
     const unsigned char *inStream, SizeT inSize, SizeT *inSizeProcessed,
     unsigned char *outStream, SizeT outSize, SizeT *outSizeProcessed);
 
+/* Incremental decoding: the whole input must be available, and the
+   output buffer must hold everything decoded so far.  Each call to
+   LzmaDecodeStep() continues decoding until outSize bytes of output
+   are present (vs->NowPos tells how far it got). */
+int LzmaDecoderInit(CLzmaDecoderState *vs,
+    const unsigned char *inStream, SizeT inSize);
+int LzmaDecodeStep(CLzmaDecoderState *vs,
+    unsigned char *outStream, SizeT outSize);
+
 #endif
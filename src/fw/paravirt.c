@@ -280,6 +280,8 @@ qemu_platform_setup(void)
     }
 
     kvmclock_init();
+    // Prefer a known tsc frequency over the pmtimer set up by pci_setup()
+    tsctimer_probe();
 
     // Initialize pci
     pci_setup();
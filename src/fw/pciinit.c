@@ -71,6 +71,12 @@ struct pci_region {
     /* pci region assignments */
     u64 base;
     struct hlist_head list;
+    /* totals of the entries in list */
+    u64 sum;
+    u64 align;
+    int count;
+    /* size of the bridge window holding the region (if known) */
+    u64 size;
 };
 
 struct pci_bus {
@@ -493,9 +499,11 @@ static void mch_mem_addr_setup(struct pci_device *dev, void *arg)
     u64 addr = Q35_HOST_BRIDGE_PCIEXBAR_ADDR;
     u32 size = Q35_HOST_BRIDGE_PCIEXBAR_SIZE;
 
-    /* setup mmconfig */
-    MCHMmcfgBDF = dev->bdf;
-    mch_mmconfig_setup(dev->bdf);
+    /* setup mmconfig (if not already done by pci_bios_init_mmconfig) */
+    if (MCHMmcfgBDF != dev->bdf) {
+        MCHMmcfgBDF = dev->bdf;
+        mch_mmconfig_setup(dev->bdf);
+    }
     e820_add(addr, size, E820_RESERVED);
 
     /* setup pci i/o window (above mmconfig) */
@@ -518,6 +526,18 @@ static const struct pci_device_id pci_platform_tbl[] = {
     PCI_DEVICE_END
 };
 
+// Enable mmconfig prior to scanning the busses so that each config
+// access is a single mmio access instead of two io port accesses.
+static void pci_bios_init_mmconfig(void)
+{
+    u16 bdf = pci_to_bdf(0, 0, 0);
+    u32 vendev = pci_config_readl(bdf, PCI_VENDOR_ID);
+    if (vendev != ((PCI_DEVICE_ID_INTEL_Q35_MCH << 16) | PCI_VENDOR_ID_INTEL))
+        return;
+    MCHMmcfgBDF = bdf;
+    mch_mmconfig_setup(bdf);
+}
+
 static void pci_bios_init_platform(void)
 {
     struct pci_device *pci;
@@ -567,27 +587,30 @@ static u8 pci_find_resource_reserve_capability(u16 bdf)
  ****************************************************************/
 
 static void
-pci_bios_init_bus_rec(int bus, u8 *pci_bus)
+pci_bios_init_bus_rec(int bus, int slots, u8 *pci_bus)
 {
-    int bdf;
+    u32 bridges[256 / 32];
+    int bdf, devfn;
     u16 class;
 
     dprintf(1, "PCI: %s bus = 0x%x\n", __func__, bus);
 
     /* prevent accidental access to unintended devices */
-    foreachbdf(bdf, bus) {
+    memset(bridges, 0, sizeof(bridges));
+    foreachbdf_slots(bdf, bus, slots) {
         class = pci_config_readw(bdf, PCI_CLASS_DEVICE);
         if (class == PCI_CLASS_BRIDGE_PCI) {
             pci_config_writeb(bdf, PCI_SECONDARY_BUS, 255);
             pci_config_writeb(bdf, PCI_SUBORDINATE_BUS, 0);
+            devfn = pci_bdf_to_devfn(bdf);
+            bridges[devfn / 32] |= 1 << (devfn % 32);
         }
     }
 
-    foreachbdf(bdf, bus) {
-        class = pci_config_readw(bdf, PCI_CLASS_DEVICE);
-        if (class != PCI_CLASS_BRIDGE_PCI) {
+    for (devfn = 0; devfn < 256; devfn++) {
+        if (!(bridges[devfn / 32] & (1 << (devfn % 32))))
             continue;
-        }
+        bdf = pci_bus_devfn_to_bdf(bus, devfn);
         dprintf(1, "PCI: %s bdf = 0x%x\n", __func__, bdf);
 
         u8 pribus = pci_config_readb(bdf, PCI_PRIMARY_BUS);
@@ -614,7 +637,7 @@ pci_bios_init_bus_rec(int bus, u8 *pci_bus)
         u8 subbus = pci_config_readb(bdf, PCI_SUBORDINATE_BUS);
         pci_config_writeb(bdf, PCI_SUBORDINATE_BUS, 255);
 
-        pci_bios_init_bus_rec(secbus, pci_bus);
+        pci_bios_init_bus_rec(secbus, pci_bridge_slots(bdf), pci_bus);
 
         if (subbus != *pci_bus) {
             u8 res_bus = *pci_bus;
@@ -655,12 +678,12 @@ pci_bios_init_bus(void)
     u8 extraroots = romfile_loadint("etc/extra-pci-roots", 0);
     u8 pci_bus = 0;
 
-    pci_bios_init_bus_rec(0 /* host bus */, &pci_bus);
+    pci_bios_init_bus_rec(0 /* host bus */, 32, &pci_bus);
 
     if (extraroots) {
         while (pci_bus < 0xff) {
             pci_bus++;
-            pci_bios_init_bus_rec(pci_bus, &pci_bus);
+            pci_bios_init_bus_rec(pci_bus, 32, &pci_bus);
         }
     }
 }
@@ -736,22 +759,31 @@ static int pci_bios_bridge_region_is64(struct pci_region *r,
 
 static u64 pci_region_align(struct pci_region *r)
 {
-    struct pci_region_entry *entry;
-    hlist_for_each_entry(entry, &r->list, node) {
-        // The first entry in the sorted list has the largest alignment
-        return entry->align;
-    }
-    return 1;
+    return r->align ?: 1;
 }
 
 static u64 pci_region_sum(struct pci_region *r)
 {
-    u64 sum = 0;
+    return r->sum;
+}
+
+static void pci_region_account(struct pci_region *r,
+                               struct pci_region_entry *entry)
+{
+    r->sum += entry->size;
+    if (entry->align > r->align)
+        r->align = entry->align;
+    r->count++;
+}
+
+// Recalculate the totals of a region after entries were moved
+static void pci_region_update(struct pci_region *r)
+{
+    r->sum = r->align = r->count = 0;
     struct pci_region_entry *entry;
     hlist_for_each_entry(entry, &r->list, node) {
-        sum += entry->size;
+        pci_region_account(r, entry);
     }
-    return sum;
 }
 
 static void pci_region_migrate_64bit_entries(struct pci_region *from,
@@ -769,6 +801,59 @@ static void pci_region_migrate_64bit_entries(struct pci_region *from,
         hlist_add(&entry->node, last);
         last = &entry->node.next;
     }
+    pci_region_update(from);
+    pci_region_update(to);
+}
+
+// Merge sort a list of 'count' entries (linked via node.next) so that
+// entries with larger alignment (and then larger size) come first.
+// Entries are added to the head of a region's list, so on a tie the
+// entry later in the list (ie, the one added first) is placed first.
+static struct hlist_node *
+pci_region_sort_list(struct hlist_node *first, int count)
+{
+    if (count <= 1) {
+        if (first)
+            first->next = NULL;
+        return first;
+    }
+    int half = count / 2, i;
+    struct hlist_node *second = first;
+    for (i = 0; i < half; i++)
+        second = second->next;
+    struct hlist_node *a = pci_region_sort_list(first, half);
+    struct hlist_node *b = pci_region_sort_list(second, count - half);
+
+    struct hlist_node *head = NULL, **tail = &head;
+    while (a && b) {
+        struct pci_region_entry *ea = container_of(
+            a, struct pci_region_entry, node);
+        struct pci_region_entry *eb = container_of(
+            b, struct pci_region_entry, node);
+        if (ea->align > eb->align
+            || (ea->align == eb->align && ea->size > eb->size)) {
+            *tail = a;
+            tail = &a->next;
+            a = a->next;
+        } else {
+            *tail = b;
+            tail = &b->next;
+            b = b->next;
+        }
+    }
+    *tail = a ?: b;
+    return head;
+}
+
+// Sort a region so that its entries can be packed without padding.
+static void pci_region_sort(struct pci_region *r)
+{
+    r->list.first = pci_region_sort_list(r->list.first, r->count);
+    struct hlist_node *n, **pprev = &r->list.first;
+    for (n = r->list.first; n; n = n->next) {
+        n->pprev = pprev;
+        pprev = &n->next;
+    }
 }
 
 static struct pci_region_entry *
@@ -787,14 +872,9 @@ pci_region_create_entry(struct pci_bus *bus, struct pci_device *dev,
     entry->align = align;
     entry->is64 = is64;
     entry->type = type;
-    // Insert into list in sorted order.
-    struct hlist_node **pprev;
-    struct pci_region_entry *pos;
-    hlist_for_each_entry_pprev(pos, pprev, &bus->r[type].list, node) {
-        if (pos->align < align || (pos->align == align && pos->size < size))
-            break;
-    }
-    hlist_add(&entry->node, pprev);
+    // The list is sorted when it is mapped (see pci_region_sort).
+    hlist_add_head(&entry->node, &bus->r[type].list);
+    pci_region_account(&bus->r[type], entry);
     return entry;
 }
 
@@ -1005,6 +1085,12 @@ static int pci_bios_check_devices(struct pci_bus *busses)
  * BAR assignment
  ****************************************************************/
 
+// Bridge window space not used by devices (hotplug reserve and
+// alignment padding) and entries that could not be naturally aligned.
+static u64 PCIRegionUnused[PCI_REGION_TYPE_COUNT];
+static u64 PCIRegionReserved[PCI_REGION_TYPE_COUNT];
+static int PCIRegionMisaligned;
+
 // Setup region bases (given the regions' size and alignment)
 static int pci_bios_init_root_regions_io(struct pci_bus *bus)
 {
@@ -1096,16 +1182,39 @@ pci_region_map_one_entry(struct pci_region_entry *entry, u64 addr)
     }
 }
 
+// Report how much of a bridge window is not used by its devices.
+static void pci_region_report(struct pci_region *r, int bus, int type)
+{
+    if (!r->size)
+        return;
+    u64 unused = r->size - r->sum;
+    if (r->count)
+        PCIRegionUnused[type] += unused;
+    else
+        PCIRegionReserved[type] += unused;
+    dprintf(3, "PCI: bus %d %s window %08llx size %08llx"
+            " used %08llx in %d entries\n"
+            , bus, region_type_name[type], r->base, r->size, r->sum, r->count);
+}
+
 static void pci_region_map_entries(struct pci_bus *busses, struct pci_region *r)
 {
+    pci_region_sort(r);
     struct hlist_node *n;
     struct pci_region_entry *entry;
     hlist_for_each_entry_safe(entry, n, &r->list, node) {
         u64 addr = r->base;
+        if (addr & (entry->align - 1))
+            PCIRegionMisaligned++;
         r->base += entry->size;
-        if (entry->bar == -1)
+        if (entry->bar == -1) {
             // Update bus base address if entry is a bridge region
-            busses[entry->dev->secondary_bus].r[entry->type].base = addr;
+            struct pci_region *sr = &busses[entry->dev->secondary_bus].r[
+                entry->type];
+            sr->base = addr;
+            sr->size = entry->size;
+            pci_region_report(sr, entry->dev->secondary_bus, entry->type);
+        }
         pci_region_map_one_entry(entry, addr);
         hlist_del(&entry->node);
         free(entry);
@@ -1120,8 +1229,8 @@ static void pci_bios_map_devices(struct pci_bus *busses)
     dprintf(1, "PCI: 32: %016llx - %016llx\n", pcimem_start, pcimem_end);
     if (pci_pad_mem64 || pci_bios_init_root_regions_mem(busses)) {
         struct pci_region r64_mem, r64_pref;
-        r64_mem.list.first = NULL;
-        r64_pref.list.first = NULL;
+        memset(&r64_mem, 0, sizeof(r64_mem));
+        memset(&r64_pref, 0, sizeof(r64_pref));
         pci_region_migrate_64bit_entries(&busses[0].r[PCI_REGION_TYPE_MEM],
                                          &r64_mem);
         pci_region_migrate_64bit_entries(&busses[0].r[PCI_REGION_TYPE_PREFMEM],
@@ -1130,37 +1239,43 @@ static void pci_bios_map_devices(struct pci_bus *busses)
         if (pci_bios_init_root_regions_mem(busses))
             panic("PCI: out of 32bit address space\n");
 
-        u64 sum_mem = pci_region_sum(&r64_mem);
-        u64 sum_pref = pci_region_sum(&r64_pref);
-        u64 align_mem = pci_region_align(&r64_mem);
-        u64 align_pref = pci_region_align(&r64_pref);
+        // Place the region with the larger alignment first so that
+        // less space is lost to aligning the second region.
+        struct pci_region *r64_first = &r64_mem, *r64_second = &r64_pref;
+        if (pci_region_align(&r64_pref) > pci_region_align(&r64_mem)) {
+            r64_first = &r64_pref;
+            r64_second = &r64_mem;
+        }
+        u64 sum_first = pci_region_sum(r64_first);
+        u64 sum_second = pci_region_sum(r64_second);
 
-        r64_mem.base = le64_to_cpu(romfile_loadint("etc/reserved-memory-end", 0));
-        if (r64_mem.base < 0x100000000LL + RamSizeOver4G)
-            r64_mem.base = 0x100000000LL + RamSizeOver4G;
+        u64 base = le64_to_cpu(romfile_loadint("etc/reserved-memory-end", 0));
+        if (base < 0x100000000LL + RamSizeOver4G)
+            base = 0x100000000LL + RamSizeOver4G;
         if (pci_mem64_top) {
-            u64 size = (ALIGN(sum_mem, (1LL<<30)) +
-                        ALIGN(sum_pref, (1LL<<30)));
+            u64 size = (ALIGN(sum_first, (1LL<<30)) +
+                        ALIGN(sum_second, (1LL<<30)));
             if (pci_pad_mem64)
                 size = ALIGN(size, pci_mem64_top >> 3);
-            if (r64_mem.base < pci_mem64_top - size) {
-                r64_mem.base = pci_mem64_top - size;
+            if (base < pci_mem64_top - size) {
+                base = pci_mem64_top - size;
             }
-            if (e820_is_used(r64_mem.base, size))
-                r64_mem.base -= size;
+            if (e820_is_used(base, size))
+                base -= size;
         }
-        r64_mem.base = ALIGN(r64_mem.base, align_mem);
-        r64_mem.base = ALIGN(r64_mem.base, (1LL<<30));    // 1G hugepage
-        r64_pref.base = r64_mem.base + sum_mem;
-        r64_pref.base = ALIGN(r64_pref.base, align_pref);
-        r64_pref.base = ALIGN(r64_pref.base, (1LL<<30));  // 1G hugepage
-        pcimem64_start = r64_mem.base;
-        pcimem64_end = r64_pref.base + sum_pref;
+        base = ALIGN(base, pci_region_align(r64_first));
+        base = ALIGN(base, (1LL<<30));    // 1G hugepage
+        r64_first->base = base;
+        base = ALIGN(base + sum_first, pci_region_align(r64_second));
+        base = ALIGN(base, (1LL<<30));    // 1G hugepage
+        r64_second->base = base;
+        pcimem64_start = r64_first->base;
+        pcimem64_end = r64_second->base + sum_second;
         pcimem64_end = ALIGN(pcimem64_end, (1LL<<30));    // 1G hugepage
         dprintf(1, "PCI: 64: %016llx - %016llx\n", pcimem64_start, pcimem64_end);
 
-        pci_region_map_entries(busses, &r64_mem);
-        pci_region_map_entries(busses, &r64_pref);
+        pci_region_map_entries(busses, r64_first);
+        pci_region_map_entries(busses, r64_second);
     } else {
         // no bars mapped high -> drop 64bit window (see dsdt)
         pcimem64_start = 0;
@@ -1172,6 +1287,17 @@ static void pci_bios_map_devices(struct pci_bus *busses)
         for (type = 0; type < PCI_REGION_TYPE_COUNT; type++)
             pci_region_map_entries(busses, &busses[bus].r[type]);
     }
+
+    int type;
+    for (type = 0; type < PCI_REGION_TYPE_COUNT; type++) {
+        if (!PCIRegionUnused[type] && !PCIRegionReserved[type])
+            continue;
+        dprintf(1, "PCI: %s bridge windows: %08llx unused by devices,"
+                " %08llx reserved on empty busses\n", region_type_name[type]
+                , PCIRegionUnused[type], PCIRegionReserved[type]);
+    }
+    if (PCIRegionMisaligned)
+        dprintf(1, "PCI: %d bars not naturally aligned\n", PCIRegionMisaligned);
 }
 
 
@@ -1216,6 +1342,7 @@ pci_setup(void)
     if (pci_probe_host() != 0) {
         return;
     }
+    pci_bios_init_mmconfig();
     pci_bios_init_bus();
 
     dprintf(1, "=== PCI device probing ===\n");
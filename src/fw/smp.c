@@ -7,21 +7,28 @@
 
 #include "config.h" // CONFIG_*
 #include "hw/rtc.h" // CMOS_BIOS_SMP_COUNT
+#include "malloc.h" // memalign_tmp
 #include "output.h" // dprintf
 #include "romfile.h" // romfile_loadint
+#include "smp.h" // struct smp_job
 #include "stacks.h" // yield
+#include "string.h" // memset
 #include "util.h" // smp_setup, msr_feature_control_setup
 #include "x86.h" // wrmsr
 #include "paravirt.h" // qemu_*_present_cpus_count
 
 #define APIC_ICR_LOW ((u8*)BUILD_APIC_ADDR + 0x300)
+#define APIC_ICR_HIGH ((u8*)BUILD_APIC_ADDR + 0x310)
 #define APIC_SVR     ((u8*)BUILD_APIC_ADDR + 0x0F0)
 #define APIC_LINT0   ((u8*)BUILD_APIC_ADDR + 0x350)
 #define APIC_LINT1   ((u8*)BUILD_APIC_ADDR + 0x360)
 
 #define APIC_ENABLED 0x0100
+#define APIC_ICR_NMI 0x4400
+#define APIC_ICR_BUSY 0x1000
 #define MSR_IA32_APIC_BASE 0x01B
 #define MSR_LOCAL_APIC_ID 0x802
+#define MSR_X2APIC_ICR 0x830
 #define MSR_IA32_APICBASE_EXTD (1ULL << 10) /* Enable x2APIC mode */
 
 static struct { u32 index; u64 val; } smp_msr[32];
@@ -50,10 +57,70 @@ smp_write_msrs(void)
 }
 
 u32 MaxCountCPUs;
-static u32 CountCPUs;
+// Incremented by entry_smp once an AP no longer uses its stack.
+u32 CountCPUs __VISIBLE;
 // 256 bits for the found APIC IDs
 static u32 FoundAPICIDs[256/32];
 
+static inline void
+atomic_inc(u32 *p)
+{
+    asm volatile("lock incl %0" : "+m" (*p) : : "cc");
+}
+
+static inline void
+atomic_dec(u32 *p)
+{
+    asm volatile("lock decl %0" : "+m" (*p) : : "cc");
+}
+
+static inline u32
+atomic_xadd(u32 *p, u32 val)
+{
+    asm volatile("lock xaddl %0, %1" : "+r" (val), "+m" (*p) : : "cc");
+    return val;
+}
+
+static inline void
+atomic_or(u32 *p, u32 bits)
+{
+    asm volatile("lock orl %1, %0" : "+m" (*p) : "ri" (bits) : "cc");
+}
+
+static inline void
+atomic_and(u32 *p, u32 bits)
+{
+    asm volatile("lock andl %1, %0" : "+m" (*p) : "ri" (bits) : "cc");
+}
+
+// Clear a bit and return its old value.
+static inline int
+atomic_btr(u32 *p, u32 bit)
+{
+    u8 old;
+    asm volatile("lock btrl %2, %0 ; setc %1"
+                 : "+m" (*p), "=qm" (old) : "r" (bit) : "cc");
+    return old;
+}
+
+static void
+spin_lock(u32 *lock)
+{
+    asm volatile(
+        "  jmp 2f\n"
+        "1:rep ; nop\n"
+        "2:lock btsl $0, %0\n"
+        "  jc 1b\n"
+        : "+m" (*lock) : : "cc", "memory");
+}
+
+static void
+spin_unlock(u32 *lock)
+{
+    barrier();
+    *(volatile u32*)lock = 0;
+}
+
 int apic_id_is_present(u8 apic_id)
 {
     return !!(FoundAPICIDs[apic_id/32] & (1ul << (apic_id % 32)));
@@ -67,7 +134,7 @@ apic_id_init(void)
     u32 apic_id = ebx>>24;
     if (MaxCountCPUs < 256) { // xAPIC mode
         // Track found apic id for use in legacy internal bios tables
-        FoundAPICIDs[apic_id/32] |= 1 << (apic_id % 32);
+        atomic_or(&FoundAPICIDs[apic_id/32], 1 << (apic_id % 32));
     } else if (ecx & CPUID_X2APIC) {
         // switch to x2APIC mode
         u64 apic_base = rdmsr(MSR_IA32_APIC_BASE);
@@ -80,22 +147,67 @@ apic_id_init(void)
     return apic_id;
 }
 
-void VISIBLE32FLAT
+static u32 SMPPrintLock;
+
+// APs kept running during POST to execute jobs (each has a private
+// stack of SMP_WORKER_STACK_SIZE bytes).
+#define SMP_WORKER_STACK_SIZE 4096
+#define SMP_WORKERS_DEFAULT 8
+#define SMP_WORKERS_MAX 32
+
+static u32 SMPWorkerStacks, SMPWorkerCount, SMPWorkerNext;
+static u32 SMPWorkersRunning, SMPWorkerStop;
+static u32 SMPWorkerAPICIDs[SMP_WORKERS_MAX];
+// Bitmaps of workers halted waiting for an nmi (see smp_worker) and
+// of workers that have not yet exited.
+static u32 SMPWorkerParked, SMPWorkerLive;
+
+// IDT loaded by the workers.  Only the nmi vector is present - it
+// points at entry_smp_wake, which returns past the worker's hlt if
+// the nmi arrived just before it.  It is in the f-seg (as is the
+// handler) so that a stray nmi remains harmless after the workers are
+// stopped.
+u64 SMPWorkerIDT[3] VARFSEG __aligned(8);
+u32 SMPWorkerHlt __VISIBLE;
+
+// Entry point for each AP (called on its own stack, if one was
+// available, so the APs may run concurrently).  Returns the stack to
+// run smp_worker() on, or zero if the AP should halt.
+u32 VISIBLE32FLAT
 handle_smp(void)
 {
     if (!CONFIG_QEMU)
-        return;
+        return 0;
 
     // Track this CPU and detect the apic_id
     int apic_id = apic_id_init();
+    spin_lock(&SMPPrintLock);
     dprintf(DEBUG_HDL_smp, "handle_smp: apic_id=0x%x\n", apic_id);
+    spin_unlock(&SMPPrintLock);
 
     smp_write_msrs();
 
-    CountCPUs++;
+    // Keep a limited number of APs running as POST workers.
+    u32 stack = 0;
+    if (SMPWorkerStacks && apic_id >= 0) {
+        u32 worker = atomic_xadd(&SMPWorkerNext, 1);
+        if (worker < SMPWorkerCount) {
+            SMPWorkerAPICIDs[worker] = apic_id;
+            stack = SMPWorkerStacks + (worker + 1) * SMP_WORKER_STACK_SIZE;
+            atomic_inc(&SMPWorkersRunning);
+        }
+    }
+
+    return stack;
 }
 
-// Atomic lock for shared stack across processors.
+// Private stacks for the APs (each is BUILD_AP_STACK_SIZE bytes).
+u32 SMPStacks __VISIBLE;
+u32 SMPStackCount __VISIBLE;
+u32 SMPStackNext __VISIBLE;
+
+// Atomic lock for shared stack across processors (used when there
+// are no private stacks, eg, on S3 resume).
 u32 SMPLock __VISIBLE;
 u32 SMPStack __VISIBLE;
 
@@ -136,9 +248,11 @@ smp_scan(void)
 
     // Init the lock.
     writel(&SMPLock, 1);
+    SMPStackNext = SMPWorkerNext = 0;
 
     // broadcast SIPI
     barrier();
+    u32 start = timer_calc(0);
     writel(APIC_ICR_LOW, 0x000C4500);
     u32 sipi_vector = BUILD_AP_BOOT_ADDR >> 12;
     writel(APIC_ICR_LOW, 0x000C4600 | sipi_vector);
@@ -149,17 +263,23 @@ smp_scan(void)
 
     // Wait for other CPUs to process the SIPI.
     u16 expected_cpus_count = qemu_get_present_cpus_count();
-    while (expected_cpus_count != CountCPUs)
-        asm volatile(
-            // Release lock and allow other processors to use the stack.
-            "  movl %%esp, %1\n"
-            "  movl $0, %0\n"
-            // Reacquire lock and take back ownership of stack.
-            "1:rep ; nop\n"
-            "  lock btsl $0, %0\n"
-            "  jc 1b\n"
-            : "+m" (SMPLock), "+m" (SMPStack)
-            : : "cc", "memory");
+    if (SMPStacks) {
+        while (expected_cpus_count != *(volatile u32*)&CountCPUs)
+            cpu_relax();
+    } else {
+        while (expected_cpus_count != CountCPUs)
+            asm volatile(
+                // Release lock and allow other processors to use the stack.
+                "  movl %%esp, %1\n"
+                "  movl $0, %0\n"
+                // Reacquire lock and take back ownership of stack.
+                "1:rep ; nop\n"
+                "  lock btsl $0, %0\n"
+                "  jc 1b\n"
+                : "+m" (SMPLock), "+m" (SMPStack)
+                : : "cc", "memory");
+    }
+    u32 usec = timer_elapsed_usec(start);
     yield();
 
     // Restore memory.
@@ -167,6 +287,8 @@ smp_scan(void)
 
     dprintf(1, "Found %d cpu(s) max supported %d cpu(s)\n", CountCPUs,
             MaxCountCPUs);
+    dprintf(1, "smp: %d ap(s) checked in %d us after sipi (%s stacks)\n"
+            , CountCPUs - 1, usec, SMPStacks ? "private" : "shared");
 }
 
 void
@@ -180,7 +302,45 @@ smp_setup(void)
     if (MaxCountCPUs < smp_count)
         MaxCountCPUs = smp_count;
 
+    // Give each AP its own stack so they need not take turns.
+    void *stacks = NULL;
+    if (smp_count > 1)
+        stacks = memalign_tmp(16, (smp_count - 1) * BUILD_AP_STACK_SIZE);
+    if (stacks) {
+        SMPStacks = (u32)stacks;
+        SMPStackCount = smp_count - 1;
+    }
+
+    // Keep some of the APs running to execute POST jobs.
+    u32 workers = romfile_loadint("etc/smp-workers", SMP_WORKERS_DEFAULT);
+    if (workers > SMP_WORKERS_MAX)
+        workers = SMP_WORKERS_MAX;
+    if (workers > smp_count - 1)
+        workers = smp_count - 1;
+    void *wstacks = NULL;
+    if (workers)
+        wstacks = memalign_tmp(16, workers * SMP_WORKER_STACK_SIZE);
+    if (wstacks) {
+        SMPWorkerStacks = (u32)wstacks;
+        SMPWorkerCount = workers;
+        // Interrupt gate for the nmi used to wake parked workers
+        extern void entry_smp_wake(void);
+        u32 wake = (u32)entry_smp_wake;
+        SMPWorkerIDT[2] = (((u64)(wake & 0xffff0000) | 0x8e00) << 32
+                           | (SEG32_MODE32_CS << 16) | (wake & 0xffff));
+        extern char smp_worker_hlt[];
+        SMPWorkerHlt = (u32)smp_worker_hlt;
+    }
+    SMPWorkerStop = SMPWorkerParked = SMPWorkerLive = 0;
+
     smp_scan();
+
+    // The remaining APs are halted and no longer use their stacks.
+    SMPStacks = SMPStackCount = 0;
+    free(stacks);
+    if (SMPWorkersRunning)
+        dprintf(1, "smp: %d ap(s) running as post workers\n"
+                , SMPWorkersRunning);
 }
 
 void
@@ -192,3 +352,219 @@ smp_resume(void)
     smp_write_msrs();
     smp_scan();
 }
+
+
+/****************************************************************
+ * POST jobs
+ ****************************************************************/
+
+static struct smp_job *SMPJobHead, *SMPJobTail;
+static u32 SMPJobLock;
+
+// Remove the next job from the queue (if any).
+static struct smp_job *
+smp_job_pop(void)
+{
+    if (!*(struct smp_job * volatile *)&SMPJobHead)
+        return NULL;
+    spin_lock(&SMPJobLock);
+    struct smp_job *job = SMPJobHead;
+    if (job) {
+        SMPJobHead = job->next;
+        if (!SMPJobHead)
+            SMPJobTail = NULL;
+    }
+    spin_unlock(&SMPJobLock);
+    return job;
+}
+
+static void
+smp_job_exec(struct smp_job *job)
+{
+    job->func(job->data);
+    barrier();
+    *(volatile u32*)&job->done = 1;
+}
+
+// Send an nmi to a POST worker.
+static void
+smp_worker_wake(u32 worker)
+{
+    u32 apic_id = SMPWorkerAPICIDs[worker];
+    if (rdmsr(MSR_IA32_APIC_BASE) & MSR_IA32_APICBASE_EXTD) {
+        wrmsr(MSR_X2APIC_ICR, ((u64)apic_id << 32) | APIC_ICR_NMI);
+        return;
+    }
+    writel(APIC_ICR_HIGH, apic_id << 24);
+    writel(APIC_ICR_LOW, APIC_ICR_NMI);
+    while (readl(APIC_ICR_LOW) & APIC_ICR_BUSY)
+        cpu_relax();
+}
+
+// Job loop for the APs kept running during POST (called from
+// entry_smp on the worker's private stack).
+void VISIBLE32FLAT __noreturn
+smp_worker(void)
+{
+    u32 worker = (((u32)__builtin_frame_address(0) - SMPWorkerStacks)
+                  / SMP_WORKER_STACK_SIZE);
+    struct descloc_s idt = {
+        .length = sizeof(SMPWorkerIDT) - 1,
+        .addr = (u32)SMPWorkerIDT,
+    };
+    lidt(&idt);
+    atomic_or(&SMPWorkerLive, 1 << worker);
+
+    for (;;) {
+        struct smp_job *job = smp_job_pop();
+        if (job) {
+            smp_job_exec(job);
+            continue;
+        }
+        if (*(volatile u32*)&SMPWorkerStop)
+            break;
+        // Halt until smp_job_start() or smp_prepboot() sends an nmi.
+        // An nmi that arrives after the checks but before the hlt
+        // makes entry_smp_wake skip the hlt, so no wake-up is lost.
+        atomic_or(&SMPWorkerParked, 1 << worker);
+        if (!*(struct smp_job * volatile *)&SMPJobHead
+            && !*(volatile u32*)&SMPWorkerStop)
+            asm volatile(".globl smp_worker_hlt\n"
+                         "smp_worker_hlt: hlt" : : : "memory");
+        atomic_and(&SMPWorkerParked, ~(1 << worker));
+    }
+    // The stack may be freed once the count drops - don't touch it again.
+    atomic_and(&SMPWorkerLive, ~(1 << worker));
+    atomic_dec(&SMPWorkersRunning);
+    for (;;)
+        hlt();
+}
+
+// Return true if jobs queued with smp_job_start() run on another cpu.
+int
+smp_job_async(void)
+{
+    return CONFIG_QEMU && SMPWorkersRunning && !SMPWorkerStop;
+}
+
+// Queue a job for an AP.  The job runs immediately on the calling cpu
+// if no workers are running.
+void
+smp_job_start(struct smp_job *job, void (*func)(void *data), void *data)
+{
+    job->func = func;
+    job->data = data;
+    job->next = NULL;
+    job->done = 0;
+    if (!smp_job_async()) {
+        smp_job_exec(job);
+        return;
+    }
+    spin_lock(&SMPJobLock);
+    if (SMPJobTail)
+        SMPJobTail->next = job;
+    else
+        SMPJobHead = job;
+    SMPJobTail = job;
+    spin_unlock(&SMPJobLock);
+
+    // Wake a parked worker to run it.
+    u32 parked = *(volatile u32*)&SMPWorkerParked;
+    while (parked) {
+        u32 worker = __ffs(parked);
+        if (atomic_btr(&SMPWorkerParked, worker)) {
+            smp_worker_wake(worker);
+            break;
+        }
+        parked &= ~(1 << worker);
+    }
+}
+
+// Wait for a job to complete.  Other threads may run while waiting.
+void
+smp_job_wait(struct smp_job *job)
+{
+    while (!*(volatile u32*)&job->done) {
+        // Help with queued jobs rather than sit idle.
+        struct smp_job *next = smp_job_pop();
+        if (next) {
+            smp_job_exec(next);
+            continue;
+        }
+        yield();
+    }
+}
+
+// Run a job on an AP and wait for it to complete.
+void
+smp_job_run(void (*func)(void *data), void *data)
+{
+    struct smp_job job;
+    smp_job_start(&job, func, data);
+    smp_job_wait(&job);
+}
+
+struct smp_memset_s {
+    struct smp_job job;
+    void *s;
+    u32 n;
+    int c;
+};
+
+static void
+smp_memset_job(void *data)
+{
+    struct smp_memset_s *m = data;
+    memset(m->s, m->c, m->n);
+}
+
+// Parts of a large memset run on separate cpus.
+#define SMP_MEMSET_CHUNK (64*1024)
+
+// Fill a large buffer, splitting the work among the POST workers.
+void
+smp_memset(void *s, int c, size_t n)
+{
+    u32 parts = n / SMP_MEMSET_CHUNK;
+    if (parts > SMPWorkerCount + 1)
+        parts = SMPWorkerCount + 1;
+    if (parts < 2 || !smp_job_async()) {
+        memset(s, c, n);
+        return;
+    }
+    struct smp_memset_s m[SMP_WORKERS_MAX];
+    u32 size = ALIGN(DIV_ROUND_UP(n, parts), 64), i;
+    for (i=0; i<parts-1; i++) {
+        m[i].s = s + i*size;
+        m[i].n = size;
+        m[i].c = c;
+        smp_job_start(&m[i].job, smp_memset_job, &m[i]);
+    }
+    memset(s + i*size, c, n - i*size);
+    for (i=0; i<parts-1; i++)
+        smp_job_wait(&m[i].job);
+}
+
+// Halt the POST workers prior to boot.
+void
+smp_prepboot(void)
+{
+    if (!CONFIG_QEMU || !SMPWorkerStacks)
+        return;
+    SMPWorkerStop = 1;
+    while (*(volatile u32*)&SMPWorkersRunning) {
+        // Wake every worker that has not exited (repeatedly, in case
+        // one had not yet loaded its IDT).
+        u32 live = *(volatile u32*)&SMPWorkerLive, worker;
+        for (worker=0; worker<SMPWorkerCount; worker++)
+            if (live & (1 << worker))
+                smp_worker_wake(worker);
+        u32 end = timer_calc(1);
+        while (*(volatile u32*)&SMPWorkersRunning && !timer_check(end))
+            cpu_relax();
+    }
+    if (SMPJobHead)
+        warn_internalerror();
+    free((void*)SMPWorkerStacks);
+    SMPWorkerStacks = SMPWorkerCount = 0;
+}
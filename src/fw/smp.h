@@ -0,0 +1,26 @@
+#ifndef __SMP_H
+#define __SMP_H
+
+#include "types.h" // u32
+
+// A unit of POST work that may be run on an idle application
+// processor.  The job function runs in 32bit flat mode with irqs
+// disabled and possibly concurrently with other jobs, so it must only
+// touch the memory passed to it - it must not call dprintf(),
+// malloc(), free(), yield(), or access hardware.
+struct smp_job {
+    void (*func)(void *data);
+    void *data;
+    struct smp_job *next;
+    u32 done;
+};
+
+// fw/smp.c
+int smp_job_async(void);
+void smp_job_start(struct smp_job *job, void (*func)(void *data), void *data);
+void smp_job_wait(struct smp_job *job);
+void smp_job_run(void (*func)(void *data), void *data);
+void smp_memset(void *s, int c, size_t n);
+void smp_prepboot(void);
+
+#endif // smp.h
@@ -101,8 +101,9 @@ static void ahci_port_writel(struct ahci_ctrl_s *ctrl, u32 pnr, u32 reg, u32 val
 }
 
 // submit ahci command + wait for result
-static int ahci_command(struct ahci_port_s *port_gf, int iswrite, int isatapi,
-                        void *buffer, u32 bsize)
+static int noinline
+ahci_command(struct ahci_port_s *port_gf, int iswrite, int isatapi,
+             void *buffer, u32 bsize)
 {
     u32 val, status, success, flags, intbits, error;
     struct ahci_ctrl_s *ctrl = port_gf->ctrl;
@@ -132,6 +133,7 @@ static int ahci_command(struct ahci_port_s *port_gf, int iswrite, int isatapi,
         ahci_port_writel(ctrl, pnr, PORT_IRQ_STAT, intbits);
     ahci_port_writel(ctrl, pnr, PORT_CMD_ISSUE, 1);
 
+    u32 start = waitprof_start();
     u32 end = timer_calc(AHCI_REQUEST_TIMEOUT);
     do {
         for (;;) {
@@ -157,6 +159,7 @@ static int ahci_command(struct ahci_port_s *port_gf, int iswrite, int isatapi,
             }
             if (timer_check(end)) {
                 warn_timeout();
+                waitprof_end(start, __func__, __builtin_return_address(0));
                 return -1;
             }
             yield();
@@ -164,6 +167,7 @@ static int ahci_command(struct ahci_port_s *port_gf, int iswrite, int isatapi,
         dprintf(8, "AHCI/%d: ... intbits 0x%x, status 0x%x ...\n",
                 pnr, intbits, status);
     } while (status & ATA_CB_STAT_BSY);
+    waitprof_end(start, __func__, __builtin_return_address(0));
 
     success = (0x00 == (status & (ATA_CB_STAT_BSY | ATA_CB_STAT_DF |
                                   ATA_CB_STAT_ERR)) &&
@@ -204,7 +208,7 @@ static int ahci_command(struct ahci_port_s *port_gf, int iswrite, int isatapi,
             val = ahci_port_readl(ctrl, pnr, PORT_SCR_CTL);
             // set Device Detection Initialization (DET) to 1 for 1 ms for comreset
             ahci_port_writel(ctrl, pnr, PORT_SCR_CTL, val | 1);
-            mdelay (1);
+            settle_mdelay(SETTLE_AHCI_COMRESET, 1);
             ahci_port_writel(ctrl, pnr, PORT_SCR_CTL, val);
         }
 
@@ -31,20 +31,27 @@
  ****************************************************************/
 
 // Wait for the specified ide state
-static inline int
+static int noinline
 await_ide(u8 mask, u8 flags, u16 base, u16 timeout)
 {
+    u32 start = waitprof_start();
     u32 end = timer_calc(timeout);
+    int ret;
     for (;;) {
         u8 status = inb(base+ATA_CB_STAT);
-        if ((status & mask) == flags)
-            return status;
+        if ((status & mask) == flags) {
+            ret = status;
+            break;
+        }
         if (timer_check(end)) {
             warn_timeout();
-            return -1;
+            ret = -1;
+            break;
         }
         yield();
     }
+    waitprof_end(start, __func__, __builtin_return_address(0));
+    return ret;
 }
 
 // Wait for the device to be not-busy.
@@ -93,7 +100,7 @@ ata_reset(struct atadrive_s *adrive_gf)
     outb(ATA_CB_DC_HD15 | ATA_CB_DC_NIEN | ATA_CB_DC_SRST, iobase2+ATA_CB_DC);
     udelay(5);
     outb(ATA_CB_DC_HD15 | ATA_CB_DC_NIEN, iobase2+ATA_CB_DC);
-    msleep(2);
+    settle_msleep(SETTLE_ATA_RESET, 2);
 
     // wait for device to become not busy.
     int status = await_not_bsy(iobase1);
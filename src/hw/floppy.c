@@ -225,7 +225,7 @@ floppy_wait_irq(void)
 {
     u8 frs = GET_BDA(floppy_recalibration_status);
     SET_BDA(floppy_recalibration_status, frs & ~FRS_IRQ);
-    u32 end = timer_calc(FLOPPY_IRQ_TIMEOUT);
+    u32 end = timer_calc(settle_time(SETTLE_FLOPPY_IRQ, FLOPPY_IRQ_TIMEOUT));
     for (;;) {
         if (timer_check(end)) {
             warn_timeout();
@@ -379,8 +379,8 @@ floppy_drive_pio(u8 floppyid, int command, u8 *param)
     floppy_dor_write(motor_mask | FLOPPY_DOR_IRQ | FLOPPY_DOR_RESET | floppyid);
 
     // If the motor was just started, wait for it to get up to speed
-    if (!motor_already_running && !CONFIG_QEMU)
-        msleep(FLOPPY_STARTUP_TIME * 125);
+    if (!motor_already_running)
+        settle_msleep(SETTLE_FLOPPY_MOTOR, FLOPPY_STARTUP_TIME * 125);
 
     // Send command.
     int ret = floppy_pio(command, param);
@@ -135,19 +135,22 @@ nvme_consume_cqe(struct nvme_sq *sq)
     return *cqe;
 }
 
-static struct nvme_cqe
+static struct nvme_cqe noinline
 nvme_wait(struct nvme_sq *sq)
 {
     static const unsigned nvme_timeout = 5000 /* ms */;
+    u32 start = waitprof_start();
     u32 to = timer_calc(nvme_timeout);
     while (!nvme_poll_cq(sq->cq)) {
         yield();
 
         if (timer_check(to)) {
             warn_timeout();
+            waitprof_end(start, __func__, __builtin_return_address(0));
             return nvme_error_cqe();
         }
     }
+    waitprof_end(start, __func__, __builtin_return_address(0));
 
     return nvme_consume_cqe(sq);
 }
@@ -8,6 +8,7 @@
 #include "output.h" // dprintf
 #include "pci.h" // pci_config_writel
 #include "pci_regs.h" // PCI_VENDOR_ID
+#include "pcidevice.h" // pci_shadow_find
 #include "util.h" // udelay
 #include "x86.h" // outl
 
@@ -26,6 +27,56 @@ static u32 ioconfig_cmd(u16 bdf, u32 addr)
     return 0x80000000 | (bdf << 8) | (addr & 0xfc);
 }
 
+static u32 pci_config_rawreadl(u16 bdf, u32 addr)
+{
+    if (!MODESEGMENT && mmconfig) {
+        return readl(mmconfig_addr(bdf, addr));
+    } else {
+        return pci_ioconfig_readl(bdf, addr);
+    }
+}
+
+// Return the shadow copy of the config dword containing 'addr' (or
+// NULL if that register is not shadowed).
+static u32 *pci_shadow_dword(u16 bdf, u32 addr)
+{
+    if (MODESEGMENT || addr >= sizeof(((struct pci_shadow*)0)->regs))
+        return NULL;
+    struct pci_device *pci = pci_shadow_find(bdf);
+    if (!pci)
+        return NULL;
+    int idx = addr / 4;
+    u8 type = pci->header_type & 0x7f;
+    if (idx == PCI_COMMAND / 4)
+        // Status register changes on its own
+        return NULL;
+    if (type == PCI_HEADER_TYPE_BRIDGE) {
+        if (idx == PCI_IO_BASE / 4)
+            // Secondary status register changes on its own
+            return NULL;
+    } else if (type != PCI_HEADER_TYPE_NORMAL && idx > PCI_HEADER_TYPE / 4) {
+        return NULL;
+    }
+    u32 *reg = &pci->shadow.regs[idx];
+    if (pci->shadow.valid & (1 << idx)) {
+        PCIShadowHits++;
+        return reg;
+    }
+    *reg = pci_config_rawreadl(bdf, idx * 4);
+    pci->shadow.valid |= 1 << idx;
+    PCIShadowMisses++;
+    return reg;
+}
+
+static void pci_shadow_invalidate(u16 bdf, u32 addr)
+{
+    if (MODESEGMENT || addr >= sizeof(((struct pci_shadow*)0)->regs))
+        return;
+    struct pci_device *pci = pci_shadow_find(bdf);
+    if (pci)
+        pci->shadow.valid &= ~(1 << (addr / 4));
+}
+
 void pci_ioconfig_writel(u16 bdf, u32 addr, u32 val)
 {
     outl(ioconfig_cmd(bdf, addr), PORT_PCI_CMD);
@@ -34,6 +85,7 @@ void pci_ioconfig_writel(u16 bdf, u32 addr, u32 val)
 
 void pci_config_writel(u16 bdf, u32 addr, u32 val)
 {
+    pci_shadow_invalidate(bdf, addr);
     if (!MODESEGMENT && mmconfig) {
         writel(mmconfig_addr(bdf, addr), val);
     } else {
@@ -49,6 +101,7 @@ void pci_ioconfig_writew(u16 bdf, u32 addr, u16 val)
 
 void pci_config_writew(u16 bdf, u32 addr, u16 val)
 {
+    pci_shadow_invalidate(bdf, addr);
     if (!MODESEGMENT && mmconfig) {
         writew(mmconfig_addr(bdf, addr), val);
     } else {
@@ -64,6 +117,7 @@ void pci_ioconfig_writeb(u16 bdf, u32 addr, u8 val)
 
 void pci_config_writeb(u16 bdf, u32 addr, u8 val)
 {
+    pci_shadow_invalidate(bdf, addr);
     if (!MODESEGMENT && mmconfig) {
         writeb(mmconfig_addr(bdf, addr), val);
     } else {
@@ -79,11 +133,10 @@ u32 pci_ioconfig_readl(u16 bdf, u32 addr)
 
 u32 pci_config_readl(u16 bdf, u32 addr)
 {
-    if (!MODESEGMENT && mmconfig) {
-        return readl(mmconfig_addr(bdf, addr));
-    } else {
-        return pci_ioconfig_readl(bdf, addr);
-    }
+    u32 *shadow = pci_shadow_dword(bdf, addr);
+    if (shadow)
+        return *shadow;
+    return pci_config_rawreadl(bdf, addr);
 }
 
 u16 pci_ioconfig_readw(u16 bdf, u32 addr)
@@ -94,6 +147,9 @@ u16 pci_ioconfig_readw(u16 bdf, u32 addr)
 
 u16 pci_config_readw(u16 bdf, u32 addr)
 {
+    u32 *shadow = pci_shadow_dword(bdf, addr);
+    if (shadow)
+        return *shadow >> ((addr & 2) * 8);
     if (!MODESEGMENT && mmconfig) {
         return readw(mmconfig_addr(bdf, addr));
     } else {
@@ -109,6 +165,9 @@ u8 pci_ioconfig_readb(u16 bdf, u32 addr)
 
 u8 pci_config_readb(u16 bdf, u32 addr)
 {
+    u32 *shadow = pci_shadow_dword(bdf, addr);
+    if (shadow)
+        return *shadow >> ((addr & 3) * 8);
     if (!MODESEGMENT && mmconfig) {
         return readb(mmconfig_addr(bdf, addr));
     } else {
@@ -124,6 +183,13 @@ pci_config_maskw(u16 bdf, u32 addr, u16 off, u16 on)
     pci_config_writew(bdf, addr, val);
 }
 
+// Check if an address is within the mmconfig window.
+int
+pci_is_mmconfig(const void *addr)
+{
+    return mmconfig && (u32)addr - mmconfig < 256*1024*1024;
+}
+
 void
 pci_enable_mmconfig(u64 addr, const char *name)
 {
@@ -133,9 +199,60 @@ pci_enable_mmconfig(u64 addr, const char *name)
     mmconfig = addr;
 }
 
+// Read the capability list of a device into its shadow.
+static int pci_shadow_caps(struct pci_device *pci)
+{
+    struct pci_shadow *shadow = &pci->shadow;
+    if (shadow->capcount != PCI_SHADOW_CAPS_UNKNOWN)
+        return shadow->capcount != PCI_SHADOW_CAPS_TOO_MANY;
+    u8 count = 0;
+    u16 status = pci_config_readw(pci->bdf, PCI_STATUS);
+    if (status & PCI_STATUS_CAP_LIST) {
+        u8 cap = pci_config_readb(pci->bdf, PCI_CAPABILITY_LIST);
+        int i;
+        for (i = 0; cap && i <= 0xff; i++) {
+            if (count >= PCI_SHADOW_CAPS) {
+                shadow->capcount = PCI_SHADOW_CAPS_TOO_MANY;
+                return 0;
+            }
+            shadow->capoff[count] = cap;
+            shadow->capid[count] = pci_config_readb(pci->bdf
+                                                    , cap + PCI_CAP_LIST_ID);
+            count++;
+            cap = pci_config_readb(pci->bdf, cap + PCI_CAP_LIST_NEXT);
+        }
+    }
+    shadow->capcount = count;
+    return 1;
+}
+
+// Search the shadow copy of a device's capability list.
+static u8 pci_shadow_find_capability(struct pci_device *pci
+                                     , u8 cap_id, u8 cap)
+{
+    struct pci_shadow *shadow = &pci->shadow;
+    int i = 0, start;
+    if (cap) {
+        while (i < shadow->capcount && shadow->capoff[i] != cap)
+            i++;
+        i++;
+    }
+    // Account for the status, pointer, and id reads of a list walk.
+    for (start = i; i < shadow->capcount; i++)
+        if (shadow->capid[i] == cap_id)
+            break;
+    PCIShadowHits += 2 + 2 * (i - start);
+    return i < shadow->capcount ? shadow->capoff[i] : 0;
+}
+
 u8 pci_find_capability(u16 bdf, u8 cap_id, u8 cap)
 {
     int i;
+    if (!MODESEGMENT) {
+        struct pci_device *pci = pci_shadow_find(bdf);
+        if (pci && pci_shadow_caps(pci))
+            return pci_shadow_find_capability(pci, cap_id, cap);
+    }
     u16 status = pci_config_readw(bdf, PCI_STATUS);
 
     if (!(status & PCI_STATUS_CAP_LIST))
@@ -184,9 +301,10 @@ int pci_ioconfig_next(int bdf, int bus)
     }
 }
 
-// Helper function for foreachbdf() macro - return next device
-int
-pci_next(int bdf, int bus)
+// Return the next device on a bus (only scanning the first 'slots'
+// device numbers of the bus).
+static int
+__pci_next(int bdf, int bus, int slots)
 {
     if (pci_bdf_to_fn(bdf) == 0
         && (pci_config_readb(bdf, PCI_HEADER_TYPE) & 0x80) == 0)
@@ -197,7 +315,7 @@ pci_next(int bdf, int bus)
         bdf += 1;
 
     for (;;) {
-        if (pci_bdf_to_bus(bdf) != bus)
+        if (pci_bdf_to_bus(bdf) != bus || pci_bdf_to_dev(bdf) >= slots)
             return -1;
 
         u16 v = pci_config_readw(bdf, PCI_VENDOR_ID);
@@ -212,6 +330,36 @@ pci_next(int bdf, int bus)
     }
 }
 
+// Helper function for foreachbdf() macro - return next device
+int
+pci_next(int bdf, int bus)
+{
+    return __pci_next(bdf, bus, 32);
+}
+
+// Helper function for foreachbdf_slots() macro - return next device
+int
+pci_next_slots(int bdf, int bus, int slots)
+{
+    return __pci_next(bdf, bus, slots);
+}
+
+// Return the number of device slots that may be populated on the
+// secondary bus of a bridge.  The link below a PCIe root port or
+// downstream port only has device 0.
+int
+pci_bridge_slots(u16 bdf)
+{
+    u8 cap = pci_find_capability(bdf, PCI_CAP_ID_EXP, 0);
+    if (!cap)
+        return 32;
+    u16 flags = pci_config_readw(bdf, cap + PCI_EXP_FLAGS);
+    u8 type = (flags & PCI_EXP_FLAGS_TYPE) >> 4;
+    if (type == PCI_EXP_TYPE_ROOT_PORT || type == PCI_EXP_TYPE_DOWNSTREAM)
+        return 1;
+    return 32;
+}
+
 // Check if PCI is available at all
 int
 pci_probe_host(void)
@@ -37,6 +37,12 @@ static inline u16 pci_bus_devfn_to_bdf(int bus, u16 devfn) {
          ; BDF >= 0                                             \
          ; BDF=pci_next(BDF, (BUS)))
 
+#define foreachbdf_slots(BDF, BUS, SLOTS)                               \
+    for (BDF=pci_next_slots(pci_bus_devfn_to_bdf((BUS), 0)-1, (BUS)      \
+                            , (SLOTS))                                  \
+         ; BDF >= 0                                                     \
+         ; BDF=pci_next_slots(BDF, (BUS), (SLOTS)))
+
 // standard PCI configration access mechanism
 void pci_ioconfig_writel(u16 bdf, u32 addr, u32 val);
 void pci_ioconfig_writew(u16 bdf, u32 addr, u16 val);
@@ -56,7 +62,10 @@ u8 pci_config_readb(u16 bdf, u32 addr);
 void pci_config_maskw(u16 bdf, u32 addr, u16 off, u16 on);
 u8 pci_find_capability(u16 bdf, u8 cap_id, u8 cap);
 int pci_next(int bdf, int bus);
+int pci_next_slots(int bdf, int bus, int slots);
+int pci_bridge_slots(u16 bdf);
 
+int pci_is_mmconfig(const void *addr);
 void pci_enable_mmconfig(u64 addr, const char *name);
 int pci_probe_host(void);
 void pci_reboot(void);
@@ -16,6 +16,141 @@
 struct hlist_head PCIDevices VARVERIFY32INIT;
 int MaxPCIBus VARFSEG;
 
+
+/****************************************************************
+ * Configuration space shadow
+ ****************************************************************/
+
+// The pci_device structs hold a copy of the registers that only
+// change when the bios writes them.  It is used during POST only.
+#define PCI_SHADOW_HASH 64
+
+static struct hlist_head *PCIShadowHash;
+u32 PCIShadowHits, PCIShadowMisses;
+
+static void
+pci_shadow_add(struct pci_device *pci)
+{
+    if (!PCIShadowHash) {
+        u32 size = sizeof(PCIShadowHash[0]) * PCI_SHADOW_HASH;
+        PCIShadowHash = malloc_tmp(size);
+        if (!PCIShadowHash)
+            return;
+        memset(PCIShadowHash, 0, size);
+    }
+    pci->shadow.capcount = PCI_SHADOW_CAPS_UNKNOWN;
+    struct hlist_head *h = &PCIShadowHash[pci->bdf % PCI_SHADOW_HASH];
+    hlist_add_head(&pci->shadow_node, h);
+}
+
+// Find the pci_device holding the shadow for a bdf (if any)
+struct pci_device *
+pci_shadow_find(u16 bdf)
+{
+    if (!PCIShadowHash)
+        return NULL;
+    struct pci_device *pci;
+    hlist_for_each_entry(pci, &PCIShadowHash[bdf % PCI_SHADOW_HASH]
+                         , shadow_node) {
+        if (pci->bdf == bdf)
+            return pci;
+    }
+    return NULL;
+}
+
+// Registers that can not be changed other than via a config write
+#define PCI_SHADOW_READONLY ((1 << (PCI_VENDOR_ID / 4))           \
+                             | (1 << (PCI_CLASS_REVISION / 4))    \
+                             | (1 << (PCI_CAPABILITY_LIST / 4)))
+
+// Discard the shadow of registers that code outside of the 32bit
+// bios (eg, an option rom) may have written.
+void
+pci_shadow_flush(void)
+{
+    if (!PCIShadowHash)
+        return;
+    int i;
+    for (i=0; i<PCI_SHADOW_HASH; i++) {
+        struct pci_device *pci;
+        hlist_for_each_entry(pci, &PCIShadowHash[i], shadow_node) {
+            pci->shadow.valid &= PCI_SHADOW_READONLY;
+        }
+    }
+}
+
+// Stop using the shadow (the pci_device structs are about to be freed).
+void
+pci_shadow_prepboot(void)
+{
+    if (!PCIShadowHash)
+        return;
+    free(PCIShadowHash);
+    PCIShadowHash = NULL;
+    dprintf(1, "PCI shadow: %d config reads avoided (%d reads cached)\n"
+            , PCIShadowHits, PCIShadowMisses);
+}
+
+
+/****************************************************************
+ * Device index
+ ****************************************************************/
+
+struct pci_index_s *PCIDeviceIndex VARFSEG, *PCIClassIndex VARFSEG;
+int PCIIndexCount VARFSEG;
+
+// Add an entry to an index.  Devices are added in bdf order, so
+// entries with the same key remain ordered by bdf.
+static void
+pci_index_add(struct pci_index_s *index, int count, u32 key, u16 bdf)
+{
+    int i = count;
+    while (i && index[i-1].key > key) {
+        index[i] = index[i-1];
+        i--;
+    }
+    index[i].key = key;
+    index[i].bdf = bdf;
+}
+
+// Build the vendor/device and class indexes of the found devices.
+static void
+pci_index_setup(int count)
+{
+    if (!count)
+        return;
+    struct pci_index_s *devindex = malloc_fseg(sizeof(*devindex) * count);
+    struct pci_index_s *classindex = malloc_fseg(sizeof(*classindex) * count);
+    if (!devindex || !classindex) {
+        warn_noalloc();
+        free(devindex);
+        free(classindex);
+        return;
+    }
+    int i = 0;
+    struct pci_device *pci;
+    foreachpci(pci) {
+        pci_index_add(devindex, i, (pci->device << 16) | pci->vendor, pci->bdf);
+        pci_index_add(classindex, i, pci_classprog(pci), pci->bdf);
+        i++;
+    }
+    PCIDeviceIndex = devindex;
+    PCIClassIndex = classindex;
+    PCIIndexCount = count;
+}
+
+// Check if the index (and the bdf to pci_device lookup) can be used.
+static int
+pci_index_ready(void)
+{
+    return PCIIndexCount && PCIShadowHash;
+}
+
+
+/****************************************************************
+ * Device list
+ ****************************************************************/
+
 // Find all PCI devices and populate PCIDevices linked list.
 void
 pci_probe_devices(void)
@@ -23,13 +158,24 @@ pci_probe_devices(void)
     dprintf(3, "PCI probe\n");
     struct pci_device *busdevs[256];
     memset(busdevs, 0, sizeof(busdevs));
+    // Busses behind a bridge that are not the secondary bus of
+    // another bridge can not have devices on them.
+    u32 emptybus[256 / 32];
+    memset(emptybus, 0, sizeof(emptybus));
     struct hlist_node **pprev = &PCIDevices.first;
     int extraroots = romfile_loadint("etc/extra-pci-roots", 0);
-    int bus = -1, lastbus = 0, rootbuses = 0, count=0;
+    int bus = -1, lastbus = 0, rootbuses = 0, count=0, skipped=0;
     while (bus < 0xff && (bus < MaxPCIBus || rootbuses < extraroots)) {
         bus++;
+        int slots = 32;
+        if (busdevs[bus]) {
+            slots = busdevs[bus]->secondary_slots;
+        } else if (emptybus[bus / 32] & (1 << (bus % 32))) {
+            skipped++;
+            continue;
+        }
         int bdf;
-        foreachbdf(bdf, bus) {
+        foreachbdf_slots(bdf, bus, slots) {
             // Create new pci_device struct and add to list.
             struct pci_device *dev = malloc_tmp(sizeof(*dev));
             if (!dev) {
@@ -40,6 +186,8 @@ pci_probe_devices(void)
             hlist_add(&dev->node, pprev);
             pprev = &dev->node.next;
             count++;
+            dev->bdf = bdf;
+            pci_shadow_add(dev);
 
             // Find parent device.
             int rootbus;
@@ -56,7 +204,6 @@ pci_probe_devices(void)
             }
 
             // Populate pci_device info.
-            dev->bdf = bdf;
             dev->parent = parent;
             dev->rootbus = rootbus;
             u32 vendev = pci_config_readl(bdf, PCI_VENDOR_ID);
@@ -70,23 +217,38 @@ pci_probe_devices(void)
             u8 v = dev->header_type & 0x7f;
             if (v == PCI_HEADER_TYPE_BRIDGE || v == PCI_HEADER_TYPE_CARDBUS) {
                 u8 secbus = pci_config_readb(bdf, PCI_SECONDARY_BUS);
+                u8 subbus = pci_config_readb(bdf, PCI_SUBORDINATE_BUS);
                 dev->secondary_bus = secbus;
+                dev->secondary_slots = pci_bridge_slots(bdf);
                 if (secbus > bus && !busdevs[secbus])
                     busdevs[secbus] = dev;
                 if (secbus > MaxPCIBus)
                     MaxPCIBus = secbus;
+                int i;
+                for (i = secbus + 1; secbus > bus && i <= subbus; i++)
+                    emptybus[i / 32] |= 1 << (i % 32);
             }
             dprintf(4, "PCI device %pP (vd=%04x:%04x c=%04x)\n"
                     , dev, dev->vendor, dev->device, dev->class);
         }
     }
     dprintf(1, "Found %d PCI devices (max PCI bus is %02x)\n", count, MaxPCIBus);
+    pci_index_setup(count);
+    if (skipped)
+        dprintf(3, "Skipped %d PCI busses without a parent bridge\n", skipped);
 }
 
 // Search for a device with the specified vendor and device ids.
 struct pci_device *
 pci_find_device(u16 vendid, u16 devid)
 {
+    if (pci_index_ready()) {
+        int pos = pci_index_find(PCIDeviceIndex, PCIIndexCount
+                                 , (devid << 16) | vendid, ~0);
+        if (pos < 0)
+            return NULL;
+        return pci_shadow_find(PCIDeviceIndex[pos].bdf);
+    }
     struct pci_device *pci;
     foreachpci(pci) {
         if (pci->vendor == vendid && pci->device == devid)
@@ -99,6 +261,21 @@ pci_find_device(u16 vendid, u16 devid)
 struct pci_device *
 pci_find_class(u16 classid)
 {
+    if (pci_index_ready()) {
+        // The index is ordered by prog_if - find the lowest bdf.
+        int pos = pci_index_find(PCIClassIndex, PCIIndexCount
+                                 , classid << 8, ~0xff);
+        if (pos < 0)
+            return NULL;
+        u16 bdf = PCIClassIndex[pos].bdf;
+        for (pos++; pos < PCIIndexCount; pos++) {
+            if (PCIClassIndex[pos].key >> 8 != classid)
+                break;
+            if (PCIClassIndex[pos].bdf < bdf)
+                bdf = PCIClassIndex[pos].bdf;
+        }
+        return pci_shadow_find(bdf);
+    }
     struct pci_device *pci;
     foreachpci(pci) {
         if (pci->class == classid)
@@ -4,6 +4,18 @@
 #include "types.h" // u32
 #include "list.h" // hlist_node
 
+#define PCI_SHADOW_CAPS 16
+#define PCI_SHADOW_CAPS_UNKNOWN  0xff
+#define PCI_SHADOW_CAPS_TOO_MANY 0xfe
+
+// Copy of read-mostly configuration space registers
+struct pci_shadow {
+    u32 regs[16];               // standard header (offsets 0x00-0x3f)
+    u16 valid;                  // bitmap of valid dwords in regs
+    u8 capcount;                // or PCI_SHADOW_CAPS_UNKNOWN/TOO_MANY
+    u8 capoff[PCI_SHADOW_CAPS], capid[PCI_SHADOW_CAPS];
+};
+
 struct pci_device {
     u16 bdf;
     u8 rootbus;
@@ -16,12 +28,26 @@ struct pci_device {
     u8 prog_if, revision;
     u8 header_type;
     u8 secondary_bus;
+    u8 secondary_slots;
+
+    // Configuration space shadow
+    struct hlist_node shadow_node;
+    struct pci_shadow shadow;
 
     // Local information on device.
     int have_driver;
 };
 extern struct hlist_head PCIDevices;
 extern int MaxPCIBus;
+extern u32 PCIShadowHits, PCIShadowMisses;
+
+// Sorted index of the pci devices (in the f-segment for use by pcibios)
+struct pci_index_s {
+    u32 key;
+    u16 bdf;
+} PACKED;
+extern struct pci_index_s *PCIDeviceIndex, *PCIClassIndex;
+extern int PCIIndexCount;
 
 static inline u32 pci_classprog(struct pci_device *pci) {
     return (pci->class << 8) | pci->prog_if;
@@ -63,6 +89,10 @@ struct pci_device_id {
     }
 
 void pci_probe_devices(void);
+struct pci_device *pci_shadow_find(u16 bdf);
+void pci_shadow_flush(void);
+void pci_shadow_prepboot(void);
+int pci_index_find(struct pci_index_s *index_gf, int count, u32 key, u32 mask);
 struct pci_device *pci_find_device(u16 vendid, u16 devid);
 struct pci_device *pci_find_class(u16 classid);
 int pci_init_device(const struct pci_device_id *ids
@@ -248,7 +248,7 @@ __ps2_command(int aux, int command, u8 *param)
             goto fail;
 
         // Receive parameters.
-        ret = ps2_recvbyte(aux, 0, 4000);
+        ret = ps2_recvbyte(aux, 0, settle_time(SETTLE_PS2_RESET, 4000));
         if (ret < 0)
             goto fail;
         param[0] = ret;
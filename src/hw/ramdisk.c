@@ -8,6 +8,7 @@
 #include "block.h" // struct drive_s
 #include "bregs.h" // struct bregs
 #include "e820map.h" // e820_add
+#include "fw/lzmadecode.h" // LzmaDecode
 #include "malloc.h" // memalign_tmphigh
 #include "memmap.h" // PAGE_SIZE
 #include "output.h" // dprintf
@@ -17,44 +18,261 @@
 #include "string.h" // memset
 #include "util.h" // process_ramdisk_op
 
-void
-ramdisk_setup(void)
+/****************************************************************
+ * Block compressed images
+ ****************************************************************/
+
+// A floppy file with a ".lzb" suffix holds the image split into
+// blocks that are lzma compressed independently (see
+// scripts/mkramdisk.py).  Only the compressed file is kept in memory,
+// and blocks are decompressed (into a small cache) when read.
+struct lzb_header {
+    u32 magic;
+    u32 disksize;
+    u32 blocksize;
+    u8 props[LZMA_PROPERTIES_SIZE];
+    u8 pad[3];
+    // Offset of each block's data in the file (plus the end offset).
+    // A block whose data is as large as the block is not compressed.
+    u32 offsets[0];
+} PACKED;
+
+#define LZB_MAGIC 0x31425a4c // "LZB1"
+#define LZB_MAX_BLOCKSIZE (64*1024)
+#define LZB_CACHE_BLOCKS 4
+
+struct ramdisk_lzb_s {
+    struct lzb_header *hdr;
+    u32 count;
+    CLzmaDecoderState state;
+    u8 *cache;
+    u32 cacheblock[LZB_CACHE_BLOCKS];
+    u32 cacheused[LZB_CACHE_BLOCKS];
+    u32 clock;
+};
+
+static struct drive_s *
+ramdisk_lzb_setup(struct romfile_s *file)
+{
+    // Copy the compressed image into ram.
+    u32 size = file->size;
+    struct lzb_header *hdr = memalign_tmphigh(PAGE_SIZE, size);
+    if (!hdr) {
+        warn_noalloc();
+        return NULL;
+    }
+    int ret = file->copy(file, hdr, size);
+    if (ret < 0 || size < sizeof(*hdr)) {
+        dprintf(1, "Invalid compressed floppy image\n");
+        goto fail;
+    }
+
+    // Check the header and block table.
+    u32 bs = hdr->blocksize;
+    if (hdr->magic != LZB_MAGIC
+        || !bs || bs % DISK_SECTOR_SIZE || bs > LZB_MAX_BLOCKSIZE) {
+        dprintf(1, "Invalid compressed floppy image\n");
+        goto fail;
+    }
+    u32 count = DIV_ROUND_UP(hdr->disksize, bs), i;
+    if (count >= (size - sizeof(*hdr)) / sizeof(u32)) {
+        dprintf(1, "Invalid compressed floppy block count %d\n", count);
+        goto fail;
+    }
+    u32 end = sizeof(*hdr) + (count + 1) * sizeof(u32);
+    for (i=0; i<=count; i++) {
+        if (hdr->offsets[i] < end || hdr->offsets[i] > size) {
+            dprintf(1, "Invalid compressed floppy block %d\n", i);
+            goto fail;
+        }
+        end = hdr->offsets[i];
+    }
+    int ftype = find_floppy_type(hdr->disksize);
+    if (ftype < 0) {
+        dprintf(3, "No floppy type found for ramdisk size\n");
+        goto fail;
+    }
+    CLzmaProperties props;
+    if (LzmaDecodeProperties(&props, hdr->props, LZMA_PROPERTIES_SIZE)) {
+        dprintf(1, "Invalid compressed floppy lzma properties\n");
+        goto fail;
+    }
+
+    // Allocate the decoder state and block cache.
+    u32 probsize = ALIGN(LzmaGetNumProbs(&props) * sizeof(CProb), 4);
+    u32 rdsize = sizeof(struct ramdisk_lzb_s) + probsize + LZB_CACHE_BLOCKS * bs;
+    struct ramdisk_lzb_s *rd = memalign_tmphigh(PAGE_SIZE, rdsize);
+    if (!rd) {
+        warn_noalloc();
+        goto fail;
+    }
+    memset(rd, 0, sizeof(*rd));
+    rd->hdr = hdr;
+    rd->count = count;
+    rd->state.Properties = props;
+    rd->state.Probs = (void*)&rd[1];
+    rd->cache = (void*)&rd[1] + probsize;
+    for (i=0; i<LZB_CACHE_BLOCKS; i++)
+        rd->cacheblock[i] = -1;
+
+    struct drive_s *drive = init_floppy((u32)rd, ftype);
+    if (!drive) {
+        free(rd);
+        goto fail;
+    }
+    drive->type = DTYPE_RAMDISK_LZB;
+    e820_add((u32)hdr, size, E820_RESERVED);
+    e820_add((u32)rd, rdsize, E820_RESERVED);
+    dprintf(1, "Mapping compressed floppy %s (%d blocks of %d) to addr %p\n"
+            , file->name, count, bs, hdr);
+    return drive;
+
+fail:
+    free(hdr);
+    return NULL;
+}
+
+// Return the uncompressed data of a block (decompressing if needed).
+static u8 *
+ramdisk_lzb_block(struct ramdisk_lzb_s *rd, u32 block)
+{
+    struct lzb_header *hdr = rd->hdr;
+    u32 bs = hdr->blocksize;
+    int i, slot = 0;
+    for (i=0; i<LZB_CACHE_BLOCKS; i++) {
+        if (rd->cacheblock[i] == block) {
+            rd->cacheused[i] = ++rd->clock;
+            return rd->cache + i * bs;
+        }
+        if (rd->cacheused[i] < rd->cacheused[slot])
+            slot = i;
+    }
+
+    // Replace the least recently used block.
+    u8 *dst = rd->cache + slot * bs;
+    u8 *src = (void*)hdr + hdr->offsets[block];
+    u32 srclen = hdr->offsets[block + 1] - hdr->offsets[block];
+    u32 dstlen = bs;
+    if (block == rd->count - 1)
+        dstlen = hdr->disksize - block * bs;
+    rd->cacheblock[slot] = -1;
+    if (srclen == dstlen) {
+        memcpy(dst, src, dstlen);
+    } else {
+        SizeT inProcessed, outProcessed;
+        int ret = LzmaDecode(&rd->state, src, srclen, &inProcessed
+                             , dst, dstlen, &outProcessed);
+        if (ret != LZMA_RESULT_OK || outProcessed != dstlen) {
+            dprintf(1, "ramdisk: block %d decode error %d\n", block, ret);
+            return NULL;
+        }
+    }
+    rd->cacheblock[slot] = block;
+    rd->cacheused[slot] = ++rd->clock;
+    return dst;
+}
+
+static int
+ramdisk_lzb_read(struct disk_op_s *op)
+{
+    struct ramdisk_lzb_s *rd = (void*)op->drive_fl->cntl_id;
+    u32 bs = rd->hdr->blocksize;
+    u32 pos = (u32)op->lba * DISK_SECTOR_SIZE;
+    u32 len = op->count * DISK_SECTOR_SIZE;
+    if (op->lba >= rd->hdr->disksize / DISK_SECTOR_SIZE
+        || len > rd->hdr->disksize - pos)
+        return DISK_RET_EBADTRACK;
+    u8 *buf = op->buf_fl;
+    while (len) {
+        u8 *data = ramdisk_lzb_block(rd, pos / bs);
+        if (!data)
+            return DISK_RET_EBADTRACK;
+        u32 boff = pos % bs, copylen = bs - boff;
+        if (copylen > len)
+            copylen = len;
+        memcpy(buf, data + boff, copylen);
+        buf += copylen;
+        pos += copylen;
+        len -= copylen;
+    }
+    return DISK_RET_SUCCESS;
+}
+
+// Disk access for block compressed images (32bit only).
+int
+ramdisk_lzb_process_op(struct disk_op_s *op)
 {
     if (!CONFIG_FLASH_FLOPPY)
-        return;
+        return 0;
 
-    // Find image.
-    struct romfile_s *file = romfile_findprefix("floppyimg/", NULL);
-    if (!file)
-        return;
-    const char *filename = file->name;
+    switch (op->command) {
+    case CMD_READ:
+        return ramdisk_lzb_read(op);
+    case CMD_WRITE:
+        // Writes can't be kept once a block leaves the cache.
+        return DISK_RET_EWRITEPROTECT;
+    default:
+        return default_process_op(op);
+    }
+}
+
+
+/****************************************************************
+ * Ramdisk setup and access
+ ****************************************************************/
+
+static struct drive_s *
+ramdisk_image_setup(struct romfile_s *file)
+{
     u32 size = file->size;
-    dprintf(3, "Found floppy file %s of size %d\n", filename, size);
     int ftype = find_floppy_type(size);
     if (ftype < 0) {
         dprintf(3, "No floppy type found for ramdisk size\n");
-        return;
+        return NULL;
     }
 
     // Allocate ram for image.
     void *pos = memalign_tmphigh(PAGE_SIZE, size);
     if (!pos) {
         warn_noalloc();
-        return;
+        return NULL;
     }
     e820_add((u32)pos, size, E820_RESERVED);
 
     // Copy image into ram.
     int ret = file->copy(file, pos, size);
     if (ret < 0)
-        return;
+        return NULL;
 
     // Setup driver.
     struct drive_s *drive = init_floppy((u32)pos, ftype);
     if (!drive)
-        return;
+        return NULL;
     drive->type = DTYPE_RAMDISK;
-    dprintf(1, "Mapping floppy %s to addr %p\n", filename, pos);
+    dprintf(1, "Mapping floppy %s to addr %p\n", file->name, pos);
+    return drive;
+}
+
+void
+ramdisk_setup(void)
+{
+    if (!CONFIG_FLASH_FLOPPY)
+        return;
+
+    // Find image.
+    struct romfile_s *file = romfile_findprefix("floppyimg/", NULL);
+    if (!file)
+        return;
+    const char *filename = file->name;
+    dprintf(3, "Found floppy file %s of size %d\n", filename, file->size);
+    int len = strlen(filename);
+    struct drive_s *drive;
+    if (len > 4 && strcmp(&filename[len-4], ".lzb") == 0)
+        drive = ramdisk_lzb_setup(file);
+    else
+        drive = ramdisk_image_setup(file);
+    if (!drive)
+        return;
     char *desc = znprintf(MAXDESCSIZE, "Ramdisk [%s]", &filename[10]);
     boot_add_floppy(drive, desc, bootprio_find_named_rom(filename, 0));
 }
@@ -145,21 +145,28 @@ struct sddrive_s {
 #define SF_HIGHCAPACITY (1<<1)
 
 // Repeatedly read a u16 register until any bit in a given mask is set
-static int
+static int noinline
 sdcard_waitw(u16 *reg, u16 mask)
 {
+    u32 start = waitprof_start();
     u32 end = timer_calc(SDHCI_PIO_TIMEOUT);
+    int ret;
     for (;;) {
         u16 v = readw(reg);
-        if (v & mask)
-            return v;
+        if (v & mask) {
+            ret = v;
+            break;
+        }
         if (timer_check(end)) {
             dprintf(1, "scard_waitw: %p %x %x\n", reg, mask, v);
             warn_timeout();
-            return -1;
+            ret = -1;
+            break;
         }
         yield();
     }
+    waitprof_end(start, __func__, __builtin_return_address(0));
+    return ret;
 }
 
 // Send an sdhci reset
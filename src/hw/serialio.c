@@ -56,6 +56,14 @@ serial_debug_preinit(void)
     oldier = serial_debug_read(SEROFF_IER);
     serial_debug_write(SEROFF_IER, newier);
 
+    // Enable the transmit fifo (if present) so output can be sent in
+    // bursts.  Changing fifo mode clears the fifo, so wait for it to
+    // drain first.
+    if (!(serial_debug_read(SEROFF_IIR) & 0xc0)) {
+        serial_debug_flush();
+        serial_debug_write(SEROFF_FCR, 0x01);
+    }
+
     if (oldparam != newparam || oldier != newier)
         dprintf(1, "Changing serial settings was %x/%x now %x/%x\n"
                 , oldparam, oldier, newparam, newier);
@@ -83,6 +91,38 @@ serial_debug_putc(char c)
     serial_debug(c);
 }
 
+// Write a buffer to the serial port.  If the uart has a fifo, then
+// it is filled a burst at a time instead of polling for each byte.
+// Newlines are sent as "\r\n" unless 'raw' is set.
+void
+serial_debug_putbuf(const char *buf, int len, int raw)
+{
+    if (!CONFIG_DEBUG_SERIAL && (!CONFIG_DEBUG_SERIAL_MMIO || MODESEGMENT))
+        return;
+    int pendcr = 0;
+    while (len) {
+        int timeout = DEBUG_TIMEOUT;
+        while ((serial_debug_read(SEROFF_LSR) & 0x20) != 0x20)
+            if (!timeout--)
+                // Ran out of time.
+                return;
+        // The transmit holding register (or fifo) is now empty.
+        int count = 1;
+        if ((serial_debug_read(SEROFF_IIR) & 0xc0) == 0xc0)
+            count = SERIAL_FIFO_SIZE;
+        while (count-- && len) {
+            if (*buf == '\n' && !pendcr && !raw) {
+                serial_debug_write(SEROFF_DATA, '\r');
+                pendcr = 1;
+                continue;
+            }
+            serial_debug_write(SEROFF_DATA, *buf++);
+            pendcr = 0;
+            len--;
+        }
+    }
+}
+
 // Make sure all serial port writes have been completely sent.
 void
 serial_debug_flush(void)
@@ -127,3 +167,15 @@ qemu_debug_putc(char c)
         // Send character to debug port.
         outb(c, port);
 }
+
+// Write a buffer to the special debugging port.
+void
+qemu_debug_putbuf(const char *buf, int len)
+{
+    ASSERT32FLAT();
+    if (!CONFIG_DEBUG_IO || !runningOnQEMU())
+        return;
+    u16 port = GET_GLOBAL(DebugOutputPort);
+    if (port)
+        outsb(port, (u8*)buf, len);
+}
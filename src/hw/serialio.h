@@ -16,15 +16,20 @@
 #define SEROFF_IER     1
 #define SEROFF_DLH     1
 #define SEROFF_IIR     2
+#define SEROFF_FCR     2
 #define SEROFF_LCR     3
 #define SEROFF_LSR     5
 #define SEROFF_MSR     6
 
+#define SERIAL_FIFO_SIZE 16
+
 void serial_debug_preinit(void);
 void serial_debug_putc(char c);
+void serial_debug_putbuf(const char *buf, int len, int raw);
 void serial_debug_flush(void);
 extern u16 DebugOutputPort;
 void qemu_debug_preinit(void);
 void qemu_debug_putc(char c);
+void qemu_debug_putbuf(const char *buf, int len);
 
 #endif // serialio.h
@@ -6,7 +6,9 @@
 
 #include "biosvar.h" // GET_LOW
 #include "config.h" // CONFIG_*
+#include "fw/paravirt.h" // runningOnQEMU
 #include "output.h" // dprintf
+#include "romfile.h" // romfile_loadint
 #include "stacks.h" // yield
 #include "util.h" // timer_setup
 #include "x86.h" // cpuid
@@ -94,7 +96,87 @@ tsctimer_setup(void)
     TimerKHz = DIV_ROUND_UP((u32)t, 1000 * PMTIMER_TO_PIT);
     TimerPort = 0;
 
-    dprintf(1, "CPU Mhz=%u\n", (TimerKHz << ShiftTSC) / 1000);
+    dprintf(1, "CPU Mhz=%u (pit calibration)\n"
+            , (TimerKHz << ShiftTSC) / 1000);
+}
+
+#define CPUID_HYPERVISOR (1 << 31)      // cpuid 1, ecx
+#define CPUID_HV_BASE    0x40000000
+#define CPUID_HV_TIMING  0x40000010
+
+// Try to find the TSC frequency (in khz) without calibrating it.
+static u32
+tsctimer_findfreq(const char **src)
+{
+    // A frequency specified by the firmware configuration always wins.
+    u32 khz = romfile_loadint("etc/tsc-khz", 0);
+    if (khz) {
+        *src = "fw_cfg";
+        return khz;
+    }
+
+    u32 max, ebx, ecx, edx, features = 0, unused;
+    cpuid(0, &max, &ebx, &ecx, &edx);
+    if (max < 1)
+        return 0;
+    cpuid(1, &unused, &unused, &features, &edx);
+    if (!(edx & CPUID_TSC))
+        return 0;
+
+    if (features & CPUID_HYPERVISOR) {
+        // Generic hypervisor timing leaf (eax = tsc khz).  The native
+        // leaves below describe the host, not the virtual tsc, so
+        // they are not used when running under a hypervisor.
+        u32 hvmax, eax;
+        cpuid(CPUID_HV_BASE, &hvmax, &ebx, &ecx, &edx);
+        if (hvmax >= CPUID_HV_TIMING && hvmax < CPUID_HV_BASE + 0x100) {
+            cpuid(CPUID_HV_TIMING, &eax, &ebx, &ecx, &edx);
+            if (eax) {
+                *src = "hypervisor cpuid";
+                return eax;
+            }
+        }
+        return 0;
+    }
+
+    // The tsc frequency leaves are only defined on Intel cpus.
+    cpuid(0, &unused, &ebx, &ecx, &edx);
+    if (ebx != 0x756e6547 || edx != 0x49656e69 || ecx != 0x6c65746e)
+        return 0; // Not "GenuineIntel"
+    if (max >= 0x15) {
+        // Time stamp counter / core crystal clock ratio
+        u32 denom, numer, crystal_hz;
+        cpuid(0x15, &denom, &numer, &crystal_hz, &edx);
+        if (denom && numer && crystal_hz) {
+            *src = "cpuid 0x15";
+            return crystal_hz / 1000 * numer / denom;
+        }
+    }
+    if (max >= 0x16) {
+        // Processor base frequency (in MHz)
+        u32 base_mhz;
+        cpuid(0x16, &base_mhz, &ebx, &ecx, &edx);
+        base_mhz &= 0xffff;
+        if (base_mhz) {
+            *src = "cpuid 0x16";
+            return base_mhz * 1000;
+        }
+    }
+    return 0;
+}
+
+// Setup the tsc timer from a known frequency if one is available.
+void
+tsctimer_probe(void)
+{
+    if (!CONFIG_TSC_TIMER)
+        return;
+    if (TimerPort != PORT_PIT_COUNTER0)
+        return; // have timer already
+    const char *src = NULL;
+    u32 khz = tsctimer_findfreq(&src);
+    if (khz)
+        tsctimer_setfreq(khz, src);
 }
 
 // Setup internal timers.
@@ -103,6 +185,7 @@ timer_setup(void)
 {
     if (!CONFIG_TSC_TIMER)
         return;
+    tsctimer_probe();
     if (TimerPort != PORT_PIT_COUNTER0)
         return; // have timer already
 
@@ -112,6 +195,7 @@ timer_setup(void)
     if (eax > 0)
         cpuid(1, &eax, &ebx, &ecx, &cpuid_features);
     if (cpuid_features & CPUID_TSC)
+        // Last resort - calibrate against the pit.
         tsctimer_setup();
 }
 
@@ -206,6 +290,23 @@ timer_calc_nsec(u32 nsecs)
     return cur + DIV_ROUND_UP(nsecs * khz, 1000000);
 }
 
+// Return the number of milliseconds since a previous timer_calc(0).
+u32
+timer_elapsed(u32 start)
+{
+    return (timer_read() - start) / GET_GLOBAL(TimerKHz);
+}
+
+// Return the number of microseconds since a previous timer_calc(0).
+u32
+timer_elapsed_usec(u32 start)
+{
+    u32 diff = timer_read() - start, khz = GET_GLOBAL(TimerKHz);
+    if (diff > 0xffffffff / 1000)
+        return diff / khz * 1000;
+    return diff * 1000 / khz;
+}
+
 // Check if the current time is past a previously calculated end time.
 int
 timer_check(u32 end)
@@ -227,24 +328,219 @@ timer_sleep(u32 end)
         yield();
 }
 
+#define WAITPROF(name, code) do {                                      \
+        u32 __start = waitprof_start();                                 \
+        code;                                                           \
+        waitprof_end(__start, name, __builtin_return_address(0));      \
+    } while (0)
+
 void ndelay(u32 count) {
-    timer_delay(timer_calc_nsec(count));
+    WAITPROF("ndelay", timer_delay(timer_calc_nsec(count)));
 }
 void udelay(u32 count) {
-    timer_delay(timer_calc_usec(count));
+    WAITPROF("udelay", timer_delay(timer_calc_usec(count)));
 }
 void mdelay(u32 count) {
-    timer_delay(timer_calc(count));
+    WAITPROF("mdelay", timer_delay(timer_calc(count)));
 }
 
 void nsleep(u32 count) {
-    timer_sleep(timer_calc_nsec(count));
+    WAITPROF("nsleep", timer_sleep(timer_calc_nsec(count)));
 }
 void usleep(u32 count) {
-    timer_sleep(timer_calc_usec(count));
+    WAITPROF("usleep", timer_sleep(timer_calc_usec(count)));
 }
 void msleep(u32 count) {
-    timer_sleep(timer_calc(count));
+    WAITPROF("msleep", timer_sleep(timer_calc(count)));
+}
+
+
+/****************************************************************
+ * Wait profiling
+ ****************************************************************/
+
+#define WAITPROF_SITES 64
+
+struct waitprof_s {
+    const char *name;
+    void *caller;
+    u32 count, ticks;
+};
+static struct waitprof_s WaitProf[WAITPROF_SITES];
+static u32 WaitProfStart, WaitProfActive, WaitProfIdle, WaitProfIdleStart;
+static u8 WaitProfOn, WaitProfIdling;
+
+// Start accounting of wait times (must be called after timer setup).
+void
+waitprof_setup(void)
+{
+    if (!CONFIG_DEBUG_WAITPROF)
+        return;
+    WaitProfStart = timer_read();
+    WaitProfOn = 1;
+}
+
+// Note the start of a delay or hardware polling loop.  Returns the
+// start time with the low bit set, or zero if profiling is off.
+u32
+waitprof_start(void)
+{
+    if (!CONFIG_DEBUG_WAITPROF || MODESEGMENT || !WaitProfOn)
+        return 0;
+    u32 now = timer_read();
+    // The cpu is idle when every thread is waiting.
+    WaitProfActive++;
+    if (!WaitProfIdling && WaitProfActive >= thread_count()) {
+        WaitProfIdleStart = now;
+        WaitProfIdling = 1;
+    }
+    return now | 1;
+}
+
+// Account the time since waitprof_start() to the given call site.
+void
+waitprof_end(u32 start, const char *name, void *caller)
+{
+    if (!CONFIG_DEBUG_WAITPROF || MODESEGMENT || !start)
+        return;
+    u32 now = timer_read();
+    WaitProfActive--;
+    if (WaitProfIdling) {
+        WaitProfIdle += now - WaitProfIdleStart;
+        WaitProfIdling = 0;
+    }
+    int i;
+    for (i=0; i<WAITPROF_SITES; i++) {
+        struct waitprof_s *wp = &WaitProf[i];
+        if (wp->name && (wp->name != name || wp->caller != caller))
+            continue;
+        wp->name = name;
+        wp->caller = caller;
+        wp->count++;
+        wp->ticks += now - start;
+        return;
+    }
+}
+
+// Report the call sites that waited the longest.
+void
+waitprof_report(void)
+{
+    if (!CONFIG_DEBUG_WAITPROF || !WaitProfOn)
+        return;
+    u32 khz = TimerKHz;
+    u32 elapsed = (timer_read() - WaitProfStart) / khz;
+    u32 idle = WaitProfIdle / khz;
+    dprintf(1, "Wait profile: %d ms elapsed, %d ms idle, %d ms busy\n"
+            , elapsed, idle, elapsed - idle);
+    for (;;) {
+        // Print sites in order of total wait time.
+        struct waitprof_s *max = NULL;
+        int i;
+        for (i=0; i<WAITPROF_SITES; i++) {
+            struct waitprof_s *wp = &WaitProf[i];
+            if (wp->count && (!max || wp->ticks > max->ticks))
+                max = wp;
+        }
+        if (!max)
+            break;
+        dprintf(1, "  %6d ms %6d calls  %s from %p\n"
+                , max->ticks / khz, max->count, max->name
+                , reloc_linkaddr(max->caller));
+        max->count = 0;
+    }
+    WaitProfOn = 0;
+}
+
+
+/****************************************************************
+ * Hardware settle delays
+ ****************************************************************/
+
+// Many hardware delays only exist to let real silicon settle.  When
+// running under an emulator these delays can be shortened, and each
+// one may be overridden with an "etc/settle-<name>" romfile.
+struct settle_info_s {
+    const char *name;
+    u16 virttime;
+};
+
+static const struct settle_info_s SettleInfo[SETTLE_MAX] = {
+    [SETTLE_USB_POSTPOWER] = { "usb-postpower", 0 },
+    [SETTLE_USB_HUB_PWRGOOD] = { "usb-hub-pwrgood", 0 },
+    [SETTLE_USB_PORT_POLL] = { "usb-port-poll", 1 },
+    [SETTLE_USB_RESET_RECOVERY] = { "usb-reset-recovery", 1 },
+    [SETTLE_USB_SETADDR_RECOVERY] = { "usb-setaddr-recovery", 0 },
+    [SETTLE_ATA_RESET] = { "ata-reset", 0 },
+    [SETTLE_AHCI_COMRESET] = { "ahci-comreset", 0 },
+    [SETTLE_PS2_RESET] = { "ps2-reset", 500 },
+    [SETTLE_FLOPPY_MOTOR] = { "floppy-motor", 0 },
+    [SETTLE_FLOPPY_IRQ] = { "floppy-irq", 1000 },
+};
+
+#define SETTLE_HARDWARE 0xffff
+
+u16 SettleTime[SETTLE_MAX] VARFSEG = {
+    [0 ... SETTLE_MAX-1] = SETTLE_HARDWARE
+};
+static u32 SettleSaved;
+
+// Determine the delay policy for each settle site.
+void
+settle_setup(void)
+{
+    int virt = runningOnQEMU() || runningOnXen();
+    int i;
+    for (i=0; i<SETTLE_MAX; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "etc/settle-%s", SettleInfo[i].name);
+        u64 val = romfile_loadint(name, virt ? SettleInfo[i].virttime
+                                  : SETTLE_HARDWARE);
+        if (val > SETTLE_HARDWARE)
+            val = SETTLE_HARDWARE;
+        SettleTime[i] = val;
+        if (val != SETTLE_HARDWARE)
+            dprintf(3, "settle %s: %d ms\n", SettleInfo[i].name, (u32)val);
+    }
+}
+
+// Return the time (in ms) to use for a hardware delay or timeout.
+u32
+settle_time(int site, u32 hwtime)
+{
+    u32 time = GET_GLOBAL(SettleTime[site]);
+    if (time == SETTLE_HARDWARE || time > hwtime)
+        return hwtime;
+    return time;
+}
+
+// Sleep for the policy time of a fixed hardware delay.
+void
+settle_msleep(int site, u32 hwtime)
+{
+    u32 time = settle_time(site, hwtime);
+    if (!MODESEGMENT)
+        SettleSaved += hwtime - time;
+    if (time)
+        msleep(time);
+}
+
+// Busy wait for the policy time of a fixed hardware delay.
+void
+settle_mdelay(int site, u32 hwtime)
+{
+    u32 time = settle_time(site, hwtime);
+    if (!MODESEGMENT)
+        SettleSaved += hwtime - time;
+    if (time)
+        mdelay(time);
+}
+
+void
+settle_report(void)
+{
+    if (SettleSaved)
+        dprintf(1, "Skipped %d ms of hardware settle delays\n", SettleSaved);
 }
 
 
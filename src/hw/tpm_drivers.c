@@ -14,7 +14,7 @@
 #include "output.h" // warn_timeout
 #include "stacks.h" // yield
 #include "string.h" // memcpy
-#include "util.h" // timer_calc_usec
+#include "util.h" // timer_calc_usec, usleep, HaveRunPost
 #include "x86.h" // readl
 
 /* low level driver implementation */
@@ -63,6 +63,22 @@ static void *crb_cmd;
 static u32 crb_resp_size;
 static void *crb_resp;
 
+/* TIS data fifo accepts 32bit accesses (PTP FIFO interface) */
+static u8 tis_dword_fifo;
+
+/* per-command latency statistics (collected during POST) */
+static u32 tpm_cmd_count, tpm_cmd_usec, tpm_cmd_max_usec;
+static u32 tpm_cmd_sent, tpm_cmd_received;
+
+/*
+ * Most register changes complete within a few microseconds, so poll
+ * without yielding at first.  After that, let other threads run and
+ * space out the register reads (each of which may be an exit to the
+ * hypervisor) up to TPM_POLL_MAX_USEC apart.
+ */
+#define TPM_POLL_SPIN_USEC 50
+#define TPM_POLL_MAX_USEC  1000
+
 static u32 wait_reg8(u8* reg, u32 time, u8 mask, u8 expect)
 {
     if (!CONFIG_TCGBIOS)
@@ -70,6 +86,8 @@ static u32 wait_reg8(u8* reg, u32 time, u8 mask, u8 expect)
 
     u32 rc = 1;
     u32 end = timer_calc_usec(time);
+    u32 spin = timer_calc_usec(TPM_POLL_SPIN_USEC);
+    u32 pause = 0;
 
     for (;;) {
         u8 value = readl(reg);
@@ -81,7 +99,14 @@ static u32 wait_reg8(u8* reg, u32 time, u8 mask, u8 expect)
             warn_timeout();
             break;
         }
-        yield();
+        if (!timer_check(spin)) {
+            cpu_relax();
+            continue;
+        }
+        pause = pause ? pause * 2 : 8;
+        if (pause > TPM_POLL_MAX_USEC)
+            pause = TPM_POLL_MAX_USEC;
+        usleep(pause);
     }
     return rc;
 }
@@ -186,6 +211,9 @@ static u32 tis_init(void)
 
     writeb(TIS_REG(0, TIS_REG_INT_ENABLE), 0);
 
+    /* the PTP FIFO interface allows 1, 2 or 4 byte data fifo accesses */
+    tis_dword_fifo = tis_get_tpm_version() == TPM_VERSION_2;
+
     init_timeout(TIS_DRIVER_IDX);
 
     return 1;
@@ -271,49 +299,58 @@ static u32 tis_ready(void)
     return rc;
 }
 
+static void tis_fifo_write(u8 locty, const u8 *data, u32 count)
+{
+    void *fifo = TIS_REG(locty, TIS_REG_DATA_FIFO);
+    u32 i = 0;
+
+    if (tis_dword_fifo)
+        for (; i + 4 <= count; i += 4)
+            writel(fifo, *(u32*)&data[i]);
+    for (; i < count; i++)
+        writeb(fifo, data[i]);
+}
+
+static void tis_fifo_read(u8 locty, u8 *data, u32 count)
+{
+    void *fifo = TIS_REG(locty, TIS_REG_DATA_FIFO);
+    u32 i = 0;
+
+    if (tis_dword_fifo)
+        for (; i + 4 <= count; i += 4)
+            *(u32*)&data[i] = readl(fifo);
+    for (; i < count; i++)
+        data[i] = readb(fifo);
+}
+
 static u32 tis_senddata(const u8 *const data, u32 len)
 {
     if (!CONFIG_TCGBIOS)
         return 0;
 
-    u32 rc = 0;
     u32 offset = 0;
-    u32 end_loop = 0;
-    u16 burst = 0;
     u8 locty = tis_find_active_locality();
     u32 timeout_d = tpm_drivers[TIS_DRIVER_IDX].timeouts[TIS_TIMEOUT_TYPE_D];
     u32 end = timer_calc_usec(timeout_d);
 
-    do {
-        while (burst == 0) {
-               burst = readl(TIS_REG(locty, TIS_REG_STS)) >> 8;
-            if (burst == 0) {
-                if (timer_check(end)) {
-                    warn_timeout();
-                    break;
-                }
-                yield();
-            }
-        }
-
+    while (offset < len) {
+        /* the burst count tells how many bytes the fifo can take */
+        u32 burst = (readl(TIS_REG(locty, TIS_REG_STS)) >> 8) & 0xffff;
         if (burst == 0) {
-            rc = TCG_RESPONSE_TIMEOUT;
-            break;
-        }
-
-        while (1) {
-            writeb(TIS_REG(locty, TIS_REG_DATA_FIFO), data[offset++]);
-            burst--;
-
-            if (burst == 0 || offset == len)
-                break;
+            if (timer_check(end)) {
+                warn_timeout();
+                return TCG_RESPONSE_TIMEOUT;
+            }
+            yield();
+            continue;
         }
+        if (burst > len - offset)
+            burst = len - offset;
+        tis_fifo_write(locty, data + offset, burst);
+        offset += burst;
+    }
 
-        if (offset == len)
-            end_loop = 1;
-    } while (end_loop == 0);
-
-    return rc;
+    return 0;
 }
 
 static u32 tis_readresp(u8 *buffer, u32 *len)
@@ -321,23 +358,26 @@ static u32 tis_readresp(u8 *buffer, u32 *len)
     if (!CONFIG_TCGBIOS)
         return 0;
 
-    u32 rc = 0;
     u32 offset = 0;
-    u32 sts;
     u8 locty = tis_find_active_locality();
 
     while (offset < *len) {
-        buffer[offset] = readb(TIS_REG(locty, TIS_REG_DATA_FIFO));
-        offset++;
-        sts = readb(TIS_REG(locty, TIS_REG_STS));
+        u32 sts = readl(TIS_REG(locty, TIS_REG_STS));
         /* data left ? */
         if ((sts & TIS_STS_DATA_AVAILABLE) == 0)
             break;
+        u32 burst = (sts >> 8) & 0xffff;
+        if (burst == 0)
+            burst = 1;
+        if (burst > *len - offset)
+            burst = *len - offset;
+        tis_fifo_read(locty, buffer + offset, burst);
+        offset += burst;
     }
 
     *len = offset;
 
-    return rc;
+    return 0;
 }
 
 
@@ -591,13 +631,11 @@ tpmhw_is_present(void)
     return TPMHW_driver_to_use != TPM_INVALID_DRIVER;
 }
 
-int
-tpmhw_transmit(u8 locty, struct tpm_req_header *req,
-               void *respbuffer, u32 *respbufferlen,
-               enum tpmDurationType to_t)
+static int
+__tpmhw_transmit(u8 locty, struct tpm_req_header *req,
+                 void *respbuffer, u32 *respbufferlen,
+                 enum tpmDurationType to_t)
 {
-    if (TPMHW_driver_to_use == TPM_INVALID_DRIVER)
-        return -1;
 
     struct tpm_driver *td = &tpm_drivers[TPMHW_driver_to_use];
 
@@ -629,6 +667,42 @@ tpmhw_transmit(u8 locty, struct tpm_req_header *req,
     return 0;
 }
 
+int
+tpmhw_transmit(u8 locty, struct tpm_req_header *req,
+               void *respbuffer, u32 *respbufferlen,
+               enum tpmDurationType to_t)
+{
+    if (TPMHW_driver_to_use == TPM_INVALID_DRIVER)
+        return -1;
+
+    u32 start = timer_calc(0);
+    int ret = __tpmhw_transmit(locty, req, respbuffer, respbufferlen, to_t);
+    u32 usec = timer_elapsed_usec(start);
+    dprintf(DEBUG_tcg, "TCGBIOS: command %08x took %d us (%d)\n"
+            , be32_to_cpu(req->ordinal), usec, ret);
+    if (HaveRunPost == 1) {
+        tpm_cmd_count++;
+        tpm_cmd_usec += usec;
+        if (usec > tpm_cmd_max_usec)
+            tpm_cmd_max_usec = usec;
+        tpm_cmd_sent += be32_to_cpu(req->totlen);
+        if (!ret)
+            tpm_cmd_received += *respbufferlen;
+    }
+    return ret;
+}
+
+void
+tpmhw_report(void)
+{
+    if (!tpm_cmd_count)
+        return;
+    dprintf(3, "TPM: %d commands in %d us (max %d us), %d bytes sent"
+            ", %d bytes received\n"
+            , tpm_cmd_count, tpm_cmd_usec, tpm_cmd_max_usec
+            , tpm_cmd_sent, tpm_cmd_received);
+}
+
 void
 tpmhw_set_timeouts(u32 timeouts[4], u32 durations[3])
 {
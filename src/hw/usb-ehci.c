@@ -126,7 +126,7 @@ check_ehci_ports(struct usb_ehci_s *cntl)
             writel(portreg, portsc);
         }
     }
-    msleep(EHCI_TIME_POSTPOWER);
+    settle_msleep(SETTLE_USB_POSTPOWER, EHCI_TIME_POSTPOWER);
 
     struct usbhub_s hub;
     memset(&hub, 0, sizeof(hub));
@@ -128,7 +128,7 @@ usb_hub_reset(struct usbhub_s *hub, u32 port)
             warn_timeout();
             goto fail;
         }
-        msleep(5);
+        msleep(settle_time(SETTLE_USB_PORT_POLL, 5));
     }
 
     // Reset complete.
@@ -194,7 +194,7 @@ usb_hub_setup(struct usbdevice_s *usbdev)
             return ret;
     }
     // Wait for port power to stabilize.
-    msleep(desc.bPwrOn2PwrGood * 2);
+    settle_msleep(SETTLE_USB_HUB_PWRGOOD, desc.bPwrOn2PwrGood * 2);
 
     usb_enumerate(&hub);
 
@@ -104,7 +104,7 @@ check_ohci_ports(struct usb_ohci_s *cntl)
     rha &= ~(RH_A_PSM | RH_A_OCPM);
     writel(&cntl->regs->roothub_status, RH_HS_LPSC);
     writel(&cntl->regs->roothub_b, RH_B_PPCM);
-    msleep((rha >> 24) * 2);
+    settle_msleep(SETTLE_USB_POSTPOWER, (rha >> 24) * 2);
     // XXX - need to sleep for USB_TIME_SIGATT if just powered up?
 
     struct usbhub_s hub;
@@ -293,18 +293,22 @@ static const int speed_to_xhci[] = {
     [ USB_SUPERSPEED ] = 4,
 };
 
-static int wait_bit(u32 *reg, u32 mask, int value, u32 timeout)
+static int noinline wait_bit(u32 *reg, u32 mask, int value, u32 timeout)
 {
+    u32 start = waitprof_start();
     u32 end = timer_calc(timeout);
+    int ret = 0;
 
     while ((readl(reg) & mask) != value) {
         if (timer_check(end)) {
             warn_timeout();
-            return -1;
+            ret = -1;
+            break;
         }
         yield();
     }
-    return 0;
+    waitprof_end(start, __func__, __builtin_return_address(0));
+    return ret;
 }
 
 
@@ -416,7 +420,7 @@ static int
 xhci_check_ports(struct usb_xhci_s *xhci)
 {
     // Wait for port power to stabilize.
-    msleep(XHCI_TIME_POSTPOWER);
+    settle_msleep(SETTLE_USB_POSTPOWER, XHCI_TIME_POSTPOWER);
 
     struct usbhub_s hub;
     memset(&hub, 0, sizeof(hub));
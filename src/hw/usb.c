@@ -298,7 +298,7 @@ usb_set_address(struct usbdevice_s *usbdev)
     if (cntl->maxaddr >= USB_MAXADDR)
         return -1;
 
-    msleep(USB_TIME_RSTRCY);
+    settle_msleep(SETTLE_USB_RESET_RECOVERY, USB_TIME_RSTRCY);
 
     // Create a pipe for the default address.
     struct usb_endpoint_descriptor epdesc = {
@@ -322,8 +322,14 @@ usb_set_address(struct usbdevice_s *usbdev)
         return -1;
     }
 
-    msleep(USB_TIME_SETADDR_RECOVERY);
+    settle_msleep(SETTLE_USB_SETADDR_RECOVERY, USB_TIME_SETADDR_RECOVERY);
 
+    // Ports on xhci controllers may be addressed concurrently - recheck
+    // the address space now that no more yielding occurs.
+    if (cntl->maxaddr >= USB_MAXADDR) {
+        usb_free_pipe(usbdev, usbdev->defpipe);
+        return -1;
+    }
     cntl->maxaddr++;
     usbdev->devaddr = cntl->maxaddr;
     usbdev->defpipe = usb_realloc_pipe(usbdev, usbdev->defpipe, &epdesc);
@@ -416,6 +422,33 @@ fail:
     return 0;
 }
 
+// Controllers that address new devices via the default address (0)
+// must not have more than one port in reset/set_address at a time.
+// The xhci controller assigns addresses itself (Address Device
+// command), so its root ports may be reset and addressed
+// concurrently.  Ports of an external hub share the hub's downstream
+// bus (where a device in reset also answers to address 0), so they
+// are still serialized.
+static int
+usb_serialize_reset(struct usbhub_s *hub)
+{
+    return hub->cntl->type != USB_TYPE_XHCI || hub->usbdev;
+}
+
+static void
+usb_reset_lock(struct usbhub_s *hub)
+{
+    if (usb_serialize_reset(hub))
+        mutex_lock(&hub->cntl->resetlock);
+}
+
+static void
+usb_reset_unlock(struct usbhub_s *hub)
+{
+    if (usb_serialize_reset(hub))
+        mutex_unlock(&hub->cntl->resetlock);
+}
+
 static void
 usb_hub_port_setup(void *data)
 {
@@ -432,13 +465,13 @@ usb_hub_port_setup(void *data)
         if (ret < 0 || timer_check(hub->detectend))
             // No device found.
             goto done;
-        msleep(5);
+        msleep(settle_time(SETTLE_USB_PORT_POLL, 5));
     }
 
     // XXX - wait USB_TIME_ATTDB time?
 
     // Reset port and determine device speed
-    mutex_lock(&hub->cntl->resetlock);
+    usb_reset_lock(hub);
     int ret = hub->op->reset(hub, port);
     if (ret < 0)
         // Reset failed
@@ -451,7 +484,7 @@ usb_hub_port_setup(void *data)
         hub->op->disconnect(hub, port);
         goto resetfail;
     }
-    mutex_unlock(&hub->cntl->resetlock);
+    usb_reset_unlock(hub);
 
     // Configure the device
     int count = configure_usb_device(usbdev);
@@ -465,7 +498,7 @@ done:
     return;
 
 resetfail:
-    mutex_unlock(&hub->cntl->resetlock);
+    usb_reset_unlock(hub);
     goto done;
 }
 
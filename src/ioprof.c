@@ -0,0 +1,150 @@
+// Accounting of port io and mmio accesses (which cause vm exits).
+//
+// This file may be distributed under the terms of the GNU LGPLv3 license.
+
+#include "config.h" // CONFIG_DEBUG_IOPROF
+#include "hw/pci.h" // pci_is_mmconfig
+#include "output.h" // dprintf
+#include "util.h" // reloc_linkaddr
+#include "x86.h" // __ioprof_port
+
+#define IOPROF_SIZE 128
+
+struct ioprof_s {
+    u32 key;
+    u32 count;
+};
+
+static struct ioprof_s IoProfPorts[IOPROF_SIZE], IoProfMmio[IOPROF_SIZE];
+static struct ioprof_s IoProfSites[IOPROF_SIZE];
+static u32 IoProfPortCount, IoProfMmioCount, IoProfEcamCount, IoProfDropped;
+static u8 IoProfDone;
+
+static void
+ioprof_add(struct ioprof_s *table, u32 key)
+{
+    u32 hash = (key * 2654435761u) >> 25;
+    int i;
+    for (i=0; i<IOPROF_SIZE; i++) {
+        struct ioprof_s *p = &table[(hash + i) % IOPROF_SIZE];
+        if (p->count && p->key != key)
+            continue;
+        p->key = key;
+        p->count++;
+        return;
+    }
+    IoProfDropped++;
+}
+
+void
+__ioprof_port(u16 port, void *caller)
+{
+    if (IoProfDone)
+        return;
+    IoProfPortCount++;
+    ioprof_add(IoProfPorts, port);
+    ioprof_add(IoProfSites, (u32)caller);
+}
+
+void
+__ioprof_mmio(const void *addr, void *caller)
+{
+    if (IoProfDone)
+        return;
+    IoProfMmioCount++;
+    if (pci_is_mmconfig(addr))
+        IoProfEcamCount++;
+    else
+        ioprof_add(IoProfMmio, (u32)addr & ~0xfff);
+    ioprof_add(IoProfSites, (u32)caller);
+}
+
+// Well known io ports.
+static struct ioport_s {
+    u16 start, end;
+    const char *name;
+} IoPortNames[] = {
+    { 0x0020, 0x0021, "pic" },
+    { 0x0040, 0x0043, "pit" },
+    { 0x0060, 0x0060, "ps2" },
+    { 0x0061, 0x0061, "pit gate" },
+    { 0x0064, 0x0064, "ps2" },
+    { 0x0070, 0x0071, "cmos" },
+    { 0x0080, 0x0080, "post code" },
+    { 0x0092, 0x0092, "a20" },
+    { 0x00a0, 0x00a1, "pic" },
+    { 0x00b2, 0x00b3, "smi" },
+    { 0x0170, 0x0177, "ata" },
+    { 0x01f0, 0x01f7, "ata" },
+    { 0x02f8, 0x02ff, "serial" },
+    { 0x0376, 0x0376, "ata" },
+    { 0x03f0, 0x03f5, "floppy" },
+    { 0x03f6, 0x03f6, "ata" },
+    { 0x03f7, 0x03f7, "floppy" },
+    { 0x03f8, 0x03ff, "serial" },
+    { 0x0402, 0x0402, "debugcon" },
+    { 0x0510, 0x051b, "fw_cfg" },
+    { 0x0600, 0x067f, "acpi pm" },
+    { 0x0cf8, 0x0cff, "pci config" },
+    { 0xb000, 0xb03f, "acpi pm" },
+};
+
+static const char *
+ioprof_portname(u16 port)
+{
+    int i;
+    for (i=0; i<ARRAY_SIZE(IoPortNames); i++)
+        if (port >= IoPortNames[i].start && port <= IoPortNames[i].end)
+            return IoPortNames[i].name;
+    return "";
+}
+
+// Remove and return the most frequent entry in a table.
+static struct ioprof_s *
+ioprof_next(struct ioprof_s *table)
+{
+    struct ioprof_s *max = NULL;
+    int i;
+    for (i=0; i<IOPROF_SIZE; i++)
+        if (table[i].count && (!max || table[i].count > max->count))
+            max = &table[i];
+    return max;
+}
+
+#define IOPROF_REPORT 16
+
+void
+ioprof_report(void)
+{
+    if (!CONFIG_DEBUG_IOPROF)
+        return;
+    IoProfDone = 1;
+    dprintf(1, "I/O profile: %d port accesses, %d mmio accesses"
+            " (%d pci mmconfig)\n"
+            , IoProfPortCount, IoProfMmioCount, IoProfEcamCount);
+    int i;
+    for (i=0; i<IOPROF_REPORT; i++) {
+        struct ioprof_s *p = ioprof_next(IoProfPorts);
+        if (!p)
+            break;
+        dprintf(1, "  port 0x%04x %8d  %s\n"
+                , p->key, p->count, ioprof_portname(p->key));
+        p->count = 0;
+    }
+    for (i=0; i<IOPROF_REPORT; i++) {
+        struct ioprof_s *p = ioprof_next(IoProfMmio);
+        if (!p)
+            break;
+        dprintf(1, "  mmio %08x %8d\n", p->key, p->count);
+        p->count = 0;
+    }
+    for (i=0; i<IOPROF_REPORT; i++) {
+        struct ioprof_s *p = ioprof_next(IoProfSites);
+        if (!p)
+            break;
+        dprintf(1, "  from %p %8d\n", reloc_linkaddr((void*)p->key), p->count);
+        p->count = 0;
+    }
+    if (IoProfDropped)
+        dprintf(1, "  (%d accesses not tracked)\n", IoProfDropped);
+}
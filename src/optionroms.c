@@ -7,6 +7,7 @@
 
 #include "bregs.h" // struct bregs
 #include "config.h" // CONFIG_*
+#include "fw/smp.h" // smp_memset
 #include "farptr.h" // FLATPTR_TO_SEG
 #include "biosvar.h" // GET_IVT
 #include "hw/pci.h" // pci_config_readl
@@ -49,6 +50,8 @@ __callrom(struct rom_header *rom, u16 offset, u16 bdf)
     start_preempt();
     farcall16big(&br);
     finish_preempt();
+    // The rom may have reprogrammed pci devices.
+    pci_shadow_flush();
 }
 
 // Execute a given option rom at the standard entry vector.
@@ -464,7 +467,7 @@ vgarom_setup(void)
     ScreenAndDebug = romfile_loadint("etc/screen-and-debug", 1);
 
     // Clear option rom memory
-    memset((void*)BUILD_ROM_START, 0, rom_get_max() - BUILD_ROM_START);
+    smp_memset((void*)BUILD_ROM_START, 0, rom_get_max() - BUILD_ROM_START);
 
     // Find and deploy PCI VGA rom.
     struct pci_device *pci;
@@ -35,15 +35,44 @@ debug_banner(void)
     dprintf(1, "BUILD: %s\n", BUILDINFO);
 }
 
+// During POST, debug output is collected here and then written to the
+// debug port(s) a line at a time.  (The buffer is only writable while
+// the bios area is writable - HaveRunPost is one.)
+#define DEBUG_BUF_SIZE 128
+static char DebugBuf[DEBUG_BUF_SIZE];
+static int DebugBufPos;
+
+// Write any buffered characters to the debug port(s).
+static void
+debug_write(void)
+{
+    int len = DebugBufPos;
+    if (!len)
+        return;
+    DebugBufPos = 0;
+    qemu_debug_putbuf(DebugBuf, len);
+    coreboot_debug_putbuf(DebugBuf, len);
+    logring_putbuf(DebugBuf, len);
+    serial_debug_putbuf(DebugBuf, len, 0);
+}
+
 // Write a character to debug port(s).
 static void
 debug_putc(struct putcinfo *action, char c)
 {
     if (! CONFIG_DEBUG_LEVEL)
         return;
+    if (!MODESEGMENT && HaveRunPost == 1) {
+        DebugBuf[DebugBufPos++] = c;
+        if (c == '\n' || DebugBufPos >= DEBUG_BUF_SIZE)
+            debug_write();
+        return;
+    }
     qemu_debug_putc(c);
-    if (!MODESEGMENT)
-        coreboot_debug_putc(c);
+    if (!MODESEGMENT) {
+        coreboot_debug_putbuf(&c, 1);
+        logring_putbuf(&c, 1);
+    }
     serial_debug_putc(c);
 }
 
@@ -51,6 +80,8 @@ debug_putc(struct putcinfo *action, char c)
 static void
 debug_flush(void)
 {
+    if (!MODESEGMENT)
+        debug_write();
     serial_debug_flush();
 }
 
@@ -327,6 +358,122 @@ bvprintf(struct putcinfo *action, const char *fmt, va_list args)
     }
 }
 
+// Binary debug records (CONFIG_DEBUG_BINARY).  Instead of formatting
+// a message, the address of its format string and the raw arguments
+// are sent - scripts/decodelog.py rebuilds the text on the host.
+#define DEBUG_RECORD_MAGIC 0x1e
+#define DEBUG_RECORD_DATA  200
+
+struct debug_record_s {
+    u8 magic;
+    u8 len;
+    u32 fmt;
+    u64 tsc;
+    u32 thread;
+    u8 data[DEBUG_RECORD_DATA];
+} PACKED;
+
+// Append a 32bit argument to a record.
+static void
+recput32(struct debug_record_s *rec, u32 val)
+{
+    if (rec->len + sizeof(val) > sizeof(rec->data))
+        return;
+    memcpy(&rec->data[rec->len], &val, sizeof(val));
+    rec->len += sizeof(val);
+}
+
+// Append a string argument (including its terminating null).
+static void
+recputs(struct debug_record_s *rec, const char *s)
+{
+    if (!s)
+        s = "(NULL)";
+    for (;;) {
+        if (rec->len >= sizeof(rec->data) - 1) {
+            rec->data[rec->len++] = '\0';
+            return;
+        }
+        char c = *s++;
+        rec->data[rec->len++] = c;
+        if (!c)
+            return;
+    }
+}
+
+// Send a debug message as a binary record.  The format string is only
+// scanned for its conversions (in the same way as bvprintf()).
+static void
+bvprintf_binary(const char *fmt, va_list args)
+{
+    struct debug_record_s rec;
+    rec.magic = DEBUG_RECORD_MAGIC;
+    rec.len = 0;
+    rec.fmt = (u32)reloc_linkaddr((void*)fmt);
+    rec.tsc = rdtscll();
+    rec.thread = 0;
+    if (CONFIG_THREADS && getCurThread() != &MainThread)
+        rec.thread = (u32)getCurThread();
+
+    const char *s;
+    for (s = fmt; *s; s++) {
+        if (*s != '%')
+            continue;
+        const char *n = s+1;
+        while (isdigit(*n))
+            n++;
+        u8 is64 = 0;
+        if (*n == 'l')
+            n++;
+        if (*n == 'l') {
+            is64 = 1;
+            n++;
+        }
+        switch (*n) {
+        case 'd':
+        case 'u':
+        case 'X':
+        case 'x':
+            recput32(&rec, va_arg(args, s32));
+            if (is64)
+                recput32(&rec, va_arg(args, s32));
+            break;
+        case 'c':
+            recput32(&rec, va_arg(args, int));
+            break;
+        case 'p':
+            if (n[1] == 'P') {
+                // Send the bdf of a 'struct pci_device'
+                struct pci_device *pci = va_arg(args, struct pci_device *);
+                recput32(&rec, pci->bdf);
+                n++;
+                break;
+            }
+            recput32(&rec, va_arg(args, u32));
+            break;
+        case '.':
+            if (n[1] != 's')
+                break;
+            n++;
+            // fall through
+        case 's':
+            recputs(&rec, va_arg(args, const char *));
+            break;
+        case '%':
+            break;
+        default:
+            n = s;
+        }
+        s = n;
+    }
+
+    debug_write();
+    u32 size = offsetof(struct debug_record_s, data) + rec.len;
+    qemu_debug_putbuf((char*)&rec, size);
+    logring_putbuf((char*)&rec, size);
+    serial_debug_putbuf((char*)&rec, size, 1);
+}
+
 void
 panic(const char *fmt, ...)
 {
@@ -347,6 +494,15 @@ panic(const char *fmt, ...)
 void
 __dprintf(const char *fmt, ...)
 {
+    if (!MODESEGMENT && CONFIG_DEBUG_BINARY) {
+        va_list args;
+        va_start(args, fmt);
+        bvprintf_binary(fmt, args);
+        va_end(args);
+        serial_debug_flush();
+        return;
+    }
+
     if (!MODESEGMENT && CONFIG_THREADS && CONFIG_DEBUG_LEVEL >= DEBUG_thread
         && *fmt != '\\' && *fmt != '/') {
         struct thread_info *cur = getCurThread();
@@ -36,12 +36,51 @@ handle_1ab101(struct bregs *regs)
     set_code_success(regs);
 }
 
+// Return the position of the first entry in a pci device index with
+// a key matching 'key' (after applying 'mask'), or -1 if not found.
+int
+pci_index_find(struct pci_index_s *index_gf, int count, u32 key, u32 mask)
+{
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (GET_GLOBALFLAT(index_gf[mid].key) < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo >= count || (GET_GLOBALFLAT(index_gf[lo].key) & mask) != key)
+        return -1;
+    return lo;
+}
+
+// Find the 'count' entry with the given key in a pci device index.
+static void
+pcibios_index_find(struct bregs *regs, struct pci_index_s *index_gf
+                   , u32 key, int count)
+{
+    int total = GET_GLOBAL(PCIIndexCount);
+    int pos = pci_index_find(index_gf, total, key, ~0);
+    if (pos < 0 || pos + count >= total
+        || GET_GLOBALFLAT(index_gf[pos + count].key) != key) {
+        set_code_invalid(regs, RET_DEVICE_NOT_FOUND);
+        return;
+    }
+    regs->bx = GET_GLOBALFLAT(index_gf[pos + count].bdf);
+    set_code_success(regs);
+}
+
 // find pci device
 static void
 handle_1ab102(struct bregs *regs)
 {
     u32 id = (regs->cx << 16) | regs->dx;
     int count = regs->si;
+    struct pci_index_s *index_gf = GET_GLOBAL(PCIDeviceIndex);
+    if (index_gf) {
+        pcibios_index_find(regs, index_gf, id, count);
+        return;
+    }
     int bus = -1;
     while (bus < GET_GLOBAL(MaxPCIBus)) {
         bus++;
@@ -66,6 +105,11 @@ handle_1ab103(struct bregs *regs)
 {
     int count = regs->si;
     u32 classprog = regs->ecx;
+    struct pci_index_s *index_gf = GET_GLOBAL(PCIClassIndex);
+    if (index_gf) {
+        pcibios_index_find(regs, index_gf, classprog, count);
+        return;
+    }
     int bus = -1;
     while (bus < GET_GLOBAL(MaxPCIBus)) {
         bus++;
@@ -11,7 +11,9 @@
 #include "config.h" // CONFIG_*
 #include "e820map.h" // e820_add
 #include "fw/paravirt.h" // qemu_cfg_preinit
+#include "fw/smp.h" // smp_prepboot
 #include "fw/xen.h" // xen_preinit
+#include "hw/pcidevice.h" // pci_shadow_prepboot
 #include "hw/pic.h" // pic_setup
 #include "hw/ps2port.h" // ps2port_setup
 #include "hw/rtc.h" // rtc_write
@@ -109,6 +111,9 @@ interface_init(void)
     coreboot_cbfs_init();
     multiboot_init();
 
+    // Start keeping debug output in memory.
+    logring_setup();
+
     // Setup ivt/bda/ebda
     ivt_init();
     bda_init();
@@ -152,6 +157,9 @@ platform_hardware_setup(void)
     // Setup timers and periodic clock interrupt
     timer_setup();
     clock_setup();
+    settle_setup();
+    waitprof_setup();
+    sampleprof_setup();
 
     // Initialize TPM
     tpm_setup();
@@ -168,6 +176,14 @@ prepareboot(void)
 
     // Finalize data structures before boot
     cdrom_prepboot();
+    settle_report();
+    waitprof_report();
+    sampleprof_report();
+    ioprof_report();
+    sercon_report();
+    cbfs_report();
+    smp_prepboot();
+    pci_shadow_prepboot();
     pmm_prepboot();
     malloc_prepboot();
     e820_prepboot();
@@ -248,6 +264,19 @@ updateRelocs(void *dest, u32 *rstart, u32 *rend, u32 delta)
         *((u32*)(dest + *reloc)) += delta;
 }
 
+static void *InitCodeDest;
+static u32 InitCodeSize;
+static s32 InitCodeDelta;
+
+// Return the address in rom.o of a (possibly relocated) code address.
+void *
+reloc_linkaddr(void *addr)
+{
+    if (addr >= InitCodeDest && addr < InitCodeDest + InitCodeSize)
+        return addr - InitCodeDelta;
+    return addr;
+}
+
 // Relocate init code and then call a function at its new address.
 // The passed function should be in the "init" section and must not
 // return.
@@ -270,6 +299,9 @@ reloc_preinit(void *f, void *arg)
     dprintf(1, "Relocating init from %p to %p (size %d)\n"
             , codesrc, codedest, initsize);
     s32 delta = codedest - codesrc;
+    InitCodeDest = codedest;
+    InitCodeSize = initsize;
+    InitCodeDelta = delta;
     memcpy(codedest, codesrc, initsize);
     updateRelocs(codedest, VSYMBOL(_reloc_abs_start), VSYMBOL(_reloc_abs_end)
                  , delta);
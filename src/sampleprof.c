@@ -0,0 +1,134 @@
+// Statistical sampling profiler.
+//
+// This file may be distributed under the terms of the GNU LGPLv3 license.
+
+#include "biosvar.h" // GET_LOW
+#include "bregs.h" // struct irqregs
+#include "config.h" // CONFIG_DEBUG_SAMPLEPROF
+#include "farptr.h" // GET_FARVAR
+#include "hw/rtc.h" // rtc_use
+#include "output.h" // dprintf
+#include "string.h" // memset
+#include "util.h" // sampleprof_setup
+
+// SeaBIOS code runs with irqs disabled except for brief windows in
+// check_irqs(), so an irq can only directly sample code outside of
+// the bios (eg, option roms).  Bios code is instead sampled each time
+// it yields.  In both cases the time since the previous sample is
+// charged to the sampled location.  After boot, the time is only
+// measured from the start of the current bios call (see
+// sampleprof_enter) so that time spent in the OS isn't charged to
+// the bios.  The histogram is kept in low memory so that it can be
+// updated from 16bit irq handlers and 16bit disk requests after boot.
+
+#define SAMPLEPROF_SIZE 256
+#define SAMPLEPROF_PROBES 16
+
+struct sample_s {
+    u32 addr;
+    u16 seg;
+    u16 pad;
+    u32 count;
+};
+
+#define SP_OFF     0
+#define SP_POST    1
+#define SP_RUNTIME 2
+
+struct sample_s SampleHist[SAMPLEPROF_SIZE] VARLOW;
+u32 SampleDropped VARLOW;
+u32 SampleLast VARLOW;
+u8 SampleMode VARLOW;
+
+// Charge the time since the last sample to the given code location.
+static void
+sampleprof_record(u16 seg, u32 addr)
+{
+    u32 ms = timer_elapsed(GET_LOW(SampleLast));
+    if (!ms)
+        return;
+    SET_LOW(SampleLast, timer_calc(0));
+    u32 hash = ((addr ^ (seg << 16)) * 2654435761u) >> 24;
+    int i;
+    for (i=0; i<SAMPLEPROF_PROBES; i++) {
+        struct sample_s *s = &SampleHist[(hash + i) % SAMPLEPROF_SIZE];
+        u32 count = GET_LOW(s->count);
+        if (count && (GET_LOW(s->addr) != addr || GET_LOW(s->seg) != seg))
+            continue;
+        SET_LOW(s->addr, addr);
+        SET_LOW(s->seg, seg);
+        SET_LOW(s->count, count + ms);
+        return;
+    }
+    SET_LOW(SampleDropped, GET_LOW(SampleDropped) + ms);
+}
+
+// Sample the code interrupted by a hardware irq.
+void
+sampleprof_irq(struct irqregs *regs)
+{
+    if (!CONFIG_DEBUG_SAMPLEPROF || GET_LOW(SampleMode) != SP_POST)
+        return;
+    struct segoff_s *frame = (void*)(regs->esp & 0xffff);
+    struct segoff_s ip = GET_FARVAR(regs->ss, *frame);
+    if (ip.seg == SEG_BIOS)
+        // Interrupted check_irqs() - bios code is sampled on yield.
+        return;
+    sampleprof_record(ip.seg, ip.offset);
+}
+
+// Sample bios code that is yielding the cpu.
+void
+sampleprof_yield(void *caller)
+{
+    if (!CONFIG_DEBUG_SAMPLEPROF || (MODESEGMENT && !MODE16)
+        || GET_LOW(SampleMode) == SP_OFF)
+        return;
+    sampleprof_record(MODE16 ? GET_SEG(CS) : 0, (u32)caller);
+}
+
+// Note the start of a runtime bios call that may yield.
+void
+sampleprof_enter(void)
+{
+    if (!CONFIG_DEBUG_SAMPLEPROF || GET_LOW(SampleMode) != SP_RUNTIME)
+        return;
+    SET_LOW(SampleLast, timer_calc(0));
+}
+
+void
+sampleprof_setup(void)
+{
+    if (!CONFIG_DEBUG_SAMPLEPROF)
+        return;
+    dprintf(1, "Sample profiler histogram at %p (%d entries)\n"
+            , SampleHist, SAMPLEPROF_SIZE);
+    SampleLast = timer_calc(0);
+    SampleMode = SP_POST;
+    // Use the rtc periodic irq to sample option roms more frequently.
+    rtc_use();
+}
+
+// Report the POST samples and start sampling runtime bios calls.
+void
+sampleprof_report(void)
+{
+    if (!CONFIG_DEBUG_SAMPLEPROF || SampleMode != SP_POST)
+        return;
+    rtc_release();
+    int i;
+    for (i=0; i<SAMPLEPROF_SIZE; i++) {
+        struct sample_s *s = &SampleHist[i];
+        if (!s->count)
+            continue;
+        void *addr = (void*)s->addr;
+        if (!s->seg)
+            addr = reloc_linkaddr(addr);
+        dprintf(1, "sampleprof: %04x:%08x %d\n", s->seg, (u32)addr, s->count);
+    }
+    dprintf(1, "sampleprof: dropped %d\n", SampleDropped);
+    memset(SampleHist, 0, sizeof(SampleHist));
+    SampleDropped = 0;
+    SampleLast = timer_calc(0);
+    SampleMode = SP_RUNTIME;
+}
@@ -8,10 +8,11 @@
 #include "bregs.h" // struct bregs
 #include "stacks.h" // yield
 #include "output.h" // dprintf
-#include "util.h" // irqtimer_calc_ticks
+#include "util.h" // timer_calc
 #include "string.h" // memcpy
 #include "romfile.h" // romfile_loadint
 #include "hw/serialio.h" // SEROFF_IER
+#include "malloc.h" // malloc_low
 #include "cp437.h"
 
 static u8 video_rows(void)
@@ -52,20 +53,60 @@ VARLOW u8 sercon_enable;
 VARFSEG struct segoff_s sercon_real_vga_handler;
 
 /*
- * We have a small output buffer here, for lazy output.  That allows
- * to avoid a whole bunch of control sequences for pointless cursor
- * moves, so when logging the output it'll be *alot* less cluttered.
+ * The uart transmit fifo is filled a burst at a time: once the line
+ * status register reports the fifo empty, sercon_fifo_size bytes may
+ * be written without checking it again.  sercon_tx_credit is the
+ * number of bytes that may still be written in the current burst.
+ * When a burst has to wait for the fifo to drain, the uart was busy
+ * from the start of the previous burst until then - those bursts are
+ * used to measure the transmit rate.
+ */
+VARLOW u8 sercon_fifo_size;
+VARLOW u8 sercon_tx_credit;
+VARLOW u8 sercon_tx_burst_bytes;
+VARLOW u32 sercon_tx_burst_start;
+VARLOW u32 sercon_tx_bytes;
+VARLOW u32 sercon_tx_bursts;
+VARLOW u32 sercon_tx_wait_us;
+VARLOW u32 sercon_tx_busy_us;
+VARLOW u32 sercon_tx_busy_bytes;
+
+/*
+ * We keep a shadow of the text screen here.  Updates only change the
+ * shadow and mark the changed span of each row dirty.  The dirty
+ * cells are sent to the terminal at the end of each int 10h call, so
+ * redrawing unchanged text costs nothing.  When flushing from the
+ * timer irq at most SERCON_TICK_BYTES are sent per tick.
  *
- * sercon_char/attr  is the actual output buffer.
+ * sercon_grid       is the screen contents (char | attr << 8).  It
+ *                   is allocated in sercon_setup() once sercon is
+ *                   enabled.
+ * sercon_dirty_lo/hi is the dirty column span of each row (clean
+ *                    if lo > hi).
+ * sercon_dirty      is set if anything (including the cursor) changed.
  * sercon_attr_last  is the most recent attribute sent to the terminal.
  * sercon_col_last   is the most recent column sent to the terminal.
  * sercon_row_last   is the most recent row sent to the terminal.
+ * sercon_flush_tick is the timer tick of the last rate limited flush.
+ * sercon_in_tick    is set while flushing from the timer irq.
  */
+#define SERCON_MAX_ROWS 25
+#define SERCON_MAX_COLS 80
+#define SERCON_BLANK    (' ' | (0x07 << 8))
+
+// Most bytes sent per timer tick when flushing from the timer irq.
+#define SERCON_TICK_BYTES   128
+#define SERCON_NO_LIMIT     0xffffffff
+
+VARLOW u16 *sercon_grid;
+VARLOW u8 sercon_dirty_lo[SERCON_MAX_ROWS];
+VARLOW u8 sercon_dirty_hi[SERCON_MAX_ROWS];
+VARLOW u8 sercon_dirty;
 VARLOW u8 sercon_attr_last;
 VARLOW u8 sercon_col_last;
 VARLOW u8 sercon_row_last;
-VARLOW u8 sercon_char;
-VARLOW u8 sercon_attr = 0x07;
+VARLOW u32 sercon_flush_tick;
+VARLOW u8 sercon_in_tick;
 
 static VAR16 u8 sercon_cmap[8] = { '0', '4', '2', '6', '1', '5', '3', '7' };
 
@@ -77,7 +118,6 @@ static int sercon_splitmode(void)
 static void sercon_putchar(u8 chr)
 {
     u16 addr = GET_LOW(sercon_port);
-    u32 end = irqtimer_calc_ticks(0x0a);
 
 #if 0
     /* for visual control sequence debugging */
@@ -85,18 +125,43 @@ static void sercon_putchar(u8 chr)
         chr = '*';
 #endif
 
-    for (;;) {
-        u8 lsr = inb(addr+SEROFF_LSR);
-        if ((lsr & 0x60) == 0x60) {
-            // Success - can write data
-            outb(chr, addr+SEROFF_DATA);
-            break;
+    u8 credit = GET_LOW(sercon_tx_credit);
+    if (!credit) {
+        // Wait for the transmit fifo to drain (without yielding when
+        // called from the timer irq).
+        u32 start = timer_calc(0);
+        u32 end = timer_calc(500);
+        int waited = 0;
+        for (;;) {
+            u8 lsr = inb(addr+SEROFF_LSR);
+            if (lsr & 0x20)
+                break;
+            if (timer_check(end))
+                return;
+            waited = 1;
+            if (GET_LOW(sercon_in_tick))
+                cpu_relax();
+            else
+                yield();
         }
-        if (irqtimer_check(end)) {
-            break;
+        u8 burst = GET_LOW(sercon_tx_burst_bytes);
+        if (waited && burst) {
+            SET_LOW(sercon_tx_wait_us, GET_LOW(sercon_tx_wait_us)
+                    + timer_elapsed_usec(start));
+            SET_LOW(sercon_tx_busy_us, GET_LOW(sercon_tx_busy_us)
+                    + timer_elapsed_usec(GET_LOW(sercon_tx_burst_start)));
+            SET_LOW(sercon_tx_busy_bytes, GET_LOW(sercon_tx_busy_bytes)
+                    + burst);
         }
-        yield();
+        credit = GET_LOW(sercon_fifo_size);
+        SET_LOW(sercon_tx_bursts, GET_LOW(sercon_tx_bursts) + 1);
+        SET_LOW(sercon_tx_burst_start, timer_calc(0));
+        SET_LOW(sercon_tx_burst_bytes, 0);
     }
+    outb(chr, addr+SEROFF_DATA);
+    SET_LOW(sercon_tx_credit, credit - 1);
+    SET_LOW(sercon_tx_burst_bytes, GET_LOW(sercon_tx_burst_bytes) + 1);
+    SET_LOW(sercon_tx_bytes, GET_LOW(sercon_tx_bytes) + 1);
 }
 
 static void sercon_term_reset(void)
@@ -122,16 +187,24 @@ static void sercon_term_no_linewrap(void)
     sercon_putchar('l');
 }
 
+static void sercon_putdec(u8 val)
+{
+    if (val >= 100)
+        sercon_putchar('0' + val / 100);
+    if (val >= 10)
+        sercon_putchar('0' + (val / 10) % 10);
+    sercon_putchar('0' + val % 10);
+}
+
 static void sercon_term_cursor_goto(u8 row, u8 col)
 {
-    row++; col++;
     sercon_putchar('\x1b');
     sercon_putchar('[');
-    sercon_putchar('0' + row / 10);
-    sercon_putchar('0' + row % 10);
-    sercon_putchar(';');
-    sercon_putchar('0' + col / 10);
-    sercon_putchar('0' + col % 10);
+    sercon_putdec(row + 1);
+    if (col) {
+        sercon_putchar(';');
+        sercon_putdec(col + 1);
+    }
     sercon_putchar('H');
 }
 
@@ -171,6 +244,9 @@ static void sercon_set_attr(u8 attr)
 static void sercon_print_utf8(u8 chr)
 {
     u16 unicode = cp437_to_unicode(chr);
+    if (unicode < 0x20 || unicode == 0x7f)
+        // Non-printing code - the terminal cursor wouldn't advance.
+        unicode = ' ';
 
     if (unicode < 0x7f) {
         sercon_putchar(unicode);
@@ -184,6 +260,69 @@ static void sercon_print_utf8(u8 chr)
     }
 }
 
+static u8 sercon_rows(void)
+{
+    u8 rows = video_rows();
+    return rows > SERCON_MAX_ROWS ? SERCON_MAX_ROWS : rows;
+}
+
+static u8 sercon_cols(void)
+{
+    u8 cols = video_cols();
+    return cols > SERCON_MAX_COLS ? SERCON_MAX_COLS : cols;
+}
+
+static u16 sercon_cell(u8 row, u8 col)
+{
+    u16 *grid = GET_LOW(sercon_grid);
+    return GET_LOWFLAT(grid[row * SERCON_MAX_COLS + col]);
+}
+
+static void sercon_cell_write(u8 row, u8 col, u16 val)
+{
+    u16 *grid = GET_LOW(sercon_grid);
+    SET_LOWFLAT(grid[row * SERCON_MAX_COLS + col], val);
+}
+
+// Update a cell of the shadow screen (and mark it dirty if it changed).
+static void sercon_cell_set(u8 row, u8 col, u16 val)
+{
+    if (row >= sercon_rows() || col >= sercon_cols())
+        return;
+    if (sercon_cell(row, col) == val)
+        return;
+    sercon_cell_write(row, col, val);
+    if (col < GET_LOW(sercon_dirty_lo[row]))
+        SET_LOW(sercon_dirty_lo[row], col);
+    if (col > GET_LOW(sercon_dirty_hi[row]))
+        SET_LOW(sercon_dirty_hi[row], col);
+    SET_LOW(sercon_dirty, 1);
+}
+
+// Fill the shadow screen after the terminal was cleared to match.
+static void sercon_grid_fill(u16 val)
+{
+    int row, col;
+    for (row = 0; row < SERCON_MAX_ROWS; row++) {
+        for (col = 0; col < SERCON_MAX_COLS; col++)
+            sercon_cell_write(row, col, val);
+        SET_LOW(sercon_dirty_lo[row], 0xff);
+        SET_LOW(sercon_dirty_hi[row], 0);
+    }
+    SET_LOW(sercon_dirty, 1);
+}
+
+// Mark the whole shadow screen dirty.
+static void sercon_grid_redraw(void)
+{
+    int row;
+    for (row = 0; row < SERCON_MAX_ROWS; row++) {
+        SET_LOW(sercon_dirty_lo[row], 0);
+        SET_LOW(sercon_dirty_hi[row], SERCON_MAX_COLS - 1);
+    }
+    SET_LOW(sercon_dirty, 1);
+}
+
 static void sercon_cursor_pos_set(u8 row, u8 col)
 {
     if (!sercon_splitmode()) {
@@ -191,118 +330,176 @@ static void sercon_cursor_pos_set(u8 row, u8 col)
     } else {
         /* let vgabios update cursor */
     }
+    SET_LOW(sercon_dirty, 1);
 }
 
-static void sercon_lazy_cursor_sync(void)
+// Move the terminal cursor using the shortest control sequence.
+static void sercon_term_move(u8 row, u8 col)
 {
-    u8 row = cursor_pos_row();
-    u8 col = cursor_pos_col();
-
-    if (GET_LOW(sercon_row_last) == row &&
-        GET_LOW(sercon_col_last) == col)
+    u8 row_last = GET_LOW(sercon_row_last);
+    u8 col_last = GET_LOW(sercon_col_last);
+    if (row == row_last && col == col_last)
         return;
 
-    if (col == 0 && GET_LOW(sercon_row_last) <= row) {
-        if (GET_LOW(sercon_col_last) != 0) {
+    if (row == row_last && col < col_last && col_last - col <= 4) {
+        while (col_last-- > col)
+            sercon_putchar(8);
+    } else if (col == 0 && row >= row_last && row - row_last <= 4) {
+        if (col_last)
             sercon_putchar('\r');
-            SET_LOW(sercon_col_last, 0);
-        }
-        while (GET_LOW(sercon_row_last) < row) {
+        while (row_last++ < row)
             sercon_putchar('\n');
-            SET_LOW(sercon_row_last, GET_LOW(sercon_row_last)+1);
-        }
-        if (GET_LOW(sercon_row_last) == row &&
-            GET_LOW(sercon_col_last) == col)
-            return;
+    } else {
+        sercon_term_cursor_goto(row, col);
     }
-
-    sercon_term_cursor_goto(row, col);
     SET_LOW(sercon_row_last, row);
     SET_LOW(sercon_col_last, col);
 }
 
-static void sercon_lazy_flush(void)
+// Send the dirty parts of the shadow screen to the terminal.  At
+// most about 'limit' bytes are sent - anything left stays dirty.
+static void sercon_flush(u32 limit)
 {
-    u8 chr, attr;
-
-    chr = GET_LOW(sercon_char);
-    attr = GET_LOW(sercon_attr);
-    if (chr) {
-        sercon_set_attr(attr);
-        sercon_print_utf8(chr);
-        SET_LOW(sercon_col_last, GET_LOW(sercon_col_last) + 1);
+    if (!GET_LOW(sercon_dirty))
+        return;
+    SET_LOW(sercon_dirty, 0);
+
+    u32 start = GET_LOW(sercon_tx_bytes);
+    u8 rows = sercon_rows(), cols = sercon_cols(), row;
+    for (row = 0; row < rows; row++) {
+        u8 lo = GET_LOW(sercon_dirty_lo[row]);
+        u8 hi = GET_LOW(sercon_dirty_hi[row]);
+        if (lo > hi)
+            continue;
+        SET_LOW(sercon_dirty_lo[row], 0xff);
+        SET_LOW(sercon_dirty_hi[row], 0);
+        if (lo >= cols)
+            continue;
+        if (hi >= cols)
+            hi = cols - 1;
+
+        sercon_term_move(row, lo);
+        u8 col;
+        for (col = lo; col <= hi; col++) {
+            if (GET_LOW(sercon_tx_bytes) - start >= limit) {
+                // Out of budget - leave the rest for the next flush.
+                SET_LOW(sercon_dirty_lo[row], col);
+                SET_LOW(sercon_dirty_hi[row], hi);
+                SET_LOW(sercon_dirty, 1);
+                break;
+            }
+            u16 val = sercon_cell(row, col);
+            sercon_set_attr(val >> 8);
+            sercon_print_utf8(val);
+        }
+        // Line wrap is off - the cursor stops at the last column.
+        SET_LOW(sercon_col_last, col < cols ? col : cols - 1);
+        if (col <= hi)
+            return;
     }
 
-    sercon_lazy_cursor_sync();
-
-    SET_LOW(sercon_attr, 0x07);
-    SET_LOW(sercon_char, 0x00);
-}
-
-static void sercon_lazy_cursor_update(u8 row, u8 col)
-{
-    sercon_cursor_pos_set(row, col);
-    SET_LOW(sercon_row_last, row);
-    SET_LOW(sercon_col_last, col);
+    sercon_term_move(cursor_pos_row(), cursor_pos_col());
 }
 
-static void sercon_lazy_backspace(void)
+// Send pending updates.  Everything is sent at the end of an int 10h
+// call; from the timer irq at most SERCON_TICK_BYTES per tick.
+static void sercon_flush_pending(void)
 {
-    u8 col;
-
-    sercon_lazy_flush();
-    col = cursor_pos_col();
-    if (col > 0) {
-        sercon_putchar(8);
-        sercon_lazy_cursor_update(cursor_pos_row(), col-1);
+    if (!GET_LOW(sercon_dirty))
+        return;
+    if (!GET_LOW(sercon_in_tick)) {
+        sercon_flush(SERCON_NO_LIMIT);
+        return;
     }
+    u32 tick = GET_BDA(timer_counter);
+    if (tick == GET_LOW(sercon_flush_tick))
+        return;
+    SET_LOW(sercon_flush_tick, tick);
+    sercon_flush(SERCON_TICK_BYTES);
 }
 
-static void sercon_lazy_cr(void)
-{
-    sercon_cursor_pos_set(cursor_pos_row(), 0);
-}
-
-static void sercon_lazy_lf(void)
+// Scroll a window of the screen up (or clear it if lines is zero).
+static void sercon_scroll(u8 top, u8 left, u8 bottom, u8 right
+                          , u8 lines, u8 attr)
 {
-    u8 row;
-
-    row = cursor_pos_row() + 1;
-    if (row >= video_rows()) {
-        /* scrolling up */
-        row = video_rows()-1;
-        if (GET_LOW(sercon_row_last) > 0) {
-            SET_LOW(sercon_row_last, GET_LOW(sercon_row_last) - 1);
+    u8 rows = sercon_rows(), cols = sercon_cols();
+    if (!rows || !cols)
+        return;
+    if (bottom >= rows)
+        bottom = rows - 1;
+    if (right >= cols)
+        right = cols - 1;
+    if (top > bottom || left > right)
+        return;
+    if (!lines || lines > bottom - top)
+        lines = bottom - top + 1;
+    u16 blank = ' ' | (attr << 8);
+    u8 row, col;
+
+    if (top == 0 && left == 0 && bottom == rows - 1 && right == cols - 1) {
+        // Full screen - have the terminal scroll (or clear) itself.
+        sercon_flush(SERCON_NO_LIMIT);
+        sercon_set_attr(attr);
+        if (lines == rows) {
+            sercon_term_clear_screen();
+        } else {
+            sercon_term_move(rows - 1, 0);
+            for (row = 0; row < lines; row++)
+                sercon_putchar('\n');
         }
+        for (row = 0; row < rows; row++)
+            for (col = 0; col < cols; col++)
+                sercon_cell_write(row, col, row + lines < rows
+                                  ? sercon_cell(row + lines, col) : blank);
+        SET_LOW(sercon_dirty, 1);
+        return;
     }
-    sercon_cursor_pos_set(row, cursor_pos_col());
+
+    // Part of the screen - update the shadow and redraw the window.
+    for (row = top; row <= bottom; row++)
+        for (col = left; col <= right; col++)
+            sercon_cell_set(row, col, row + lines <= bottom
+                            ? sercon_cell(row + lines, col) : blank);
 }
 
-static void sercon_lazy_move_cursor(void)
+static void sercon_teletype(u8 chr)
 {
-    u8 col;
+    u8 rows = sercon_rows(), cols = sercon_cols();
+    u8 row = cursor_pos_row(), col = cursor_pos_col();
+    if (!rows || !cols)
+        return;
 
-    col = cursor_pos_col() + 1;
-    if (col >= video_cols()) {
-        sercon_lazy_cr();
-        sercon_lazy_lf();
-    } else {
-        sercon_cursor_pos_set(cursor_pos_row(), col);
+    switch (chr) {
+    case 7:
+        sercon_putchar(0x07);
+        return;
+    case 8:
+        if (col > 0)
+            col--;
+        break;
+    case '\r':
+        col = 0;
+        break;
+    case '\n':
+        row++;
+        break;
+    default:
+        // Teletype output keeps the attribute already on the screen.
+        if (row < rows && col < cols)
+            sercon_cell_set(row, col
+                            , chr | (sercon_cell(row, col) & 0xff00));
+        col++;
+        if (col >= cols) {
+            col = 0;
+            row++;
+        }
+        break;
     }
-}
-
-static void sercon_lazy_putchar(u8 chr, u8 attr, u8 teletype)
-{
-    if (cursor_pos_row() != GET_LOW(sercon_row_last) ||
-        cursor_pos_col() != GET_LOW(sercon_col_last)) {
-        sercon_lazy_flush();
+    if (row >= rows) {
+        sercon_scroll(0, 0, rows - 1, cols - 1, 1, 0x07);
+        row = rows - 1;
     }
-
-    SET_LOW(sercon_char, chr);
-    if (teletype)
-        sercon_lazy_move_cursor();
-    else
-        SET_LOW(sercon_attr, attr);
+    sercon_cursor_pos_set(row, col);
 }
 
 /* Set video mode */
@@ -348,8 +545,13 @@ static void sercon_1000(struct bregs *regs)
 
     sercon_term_reset();
     sercon_term_no_linewrap();
-    if (clearscreen)
+    if (clearscreen) {
         sercon_term_clear_screen();
+        sercon_grid_fill(SERCON_BLANK);
+    } else {
+        // The terminal reset may have cleared it - redraw everything.
+        sercon_grid_redraw();
+    }
 }
 
 /* Set text-mode cursor shape */
@@ -376,78 +578,50 @@ static void sercon_1003(struct bregs *regs)
 /* Scroll up window */
 static void sercon_1006(struct bregs *regs)
 {
-    sercon_lazy_flush();
-    if (regs->al == 0) {
-        /* clear rect, do only in case this looks like a fullscreen clear */
-        if (regs->ch == 0 &&
-            regs->cl == 0 &&
-            regs->dh == video_rows()-1 &&
-            regs->dl == video_cols()-1) {
-            sercon_set_attr(regs->bh);
-            sercon_term_clear_screen();
-        }
-    } else {
-        sercon_putchar('\r');
-        sercon_putchar('\n');
-    }
+    sercon_scroll(regs->ch, regs->cl, regs->dh, regs->dl, regs->al, regs->bh);
 }
 
 /* Read character and attribute at cursor position */
 static void sercon_1008(struct bregs *regs)
 {
-    regs->ah = 0x07;
-    regs->bh = ' ';
+    u8 row = cursor_pos_row(), col = cursor_pos_col();
+    if (row < sercon_rows() && col < sercon_cols()) {
+        u16 val = sercon_cell(row, col);
+        regs->al = val;
+        regs->ah = val >> 8;
+    } else {
+        regs->al = ' ';
+        regs->ah = 0x07;
+    }
 }
 
 /* Write character and attribute at cursor position */
 static void sercon_1009(struct bregs *regs)
 {
+    u8 rows = sercon_rows(), cols = sercon_cols();
+    u8 row = cursor_pos_row(), col = cursor_pos_col();
     u16 count = regs->cx;
 
-    if (count == 1) {
-        sercon_lazy_putchar(regs->al, regs->bl, 0);
-
-    } else if (regs->al == 0x20 &&
-               video_rows() * video_cols() == count &&
-               cursor_pos_row() == 0 &&
-               cursor_pos_col() == 0) {
+    if (regs->al == 0x20 && row == 0 && col == 0 && count >= rows * cols) {
         /* override everything with spaces -> this is clear screen */
-        sercon_lazy_flush();
-        sercon_set_attr(regs->bl);
-        sercon_term_clear_screen();
+        sercon_scroll(0, 0, rows - 1, cols - 1, 0, regs->bl);
+        return;
+    }
 
-    } else {
-        sercon_lazy_flush();
-        sercon_set_attr(regs->bl);
-        while (count) {
-            sercon_print_utf8(regs->al);
-            count--;
+    u16 val = regs->al | (regs->bl << 8);
+    while (count-- && row < rows) {
+        sercon_cell_set(row, col, val);
+        if (++col >= cols) {
+            col = 0;
+            row++;
         }
-        sercon_term_cursor_goto(cursor_pos_row(),
-                                cursor_pos_col());
     }
 }
 
 /* Teletype output */
 static void sercon_100e(struct bregs *regs)
 {
-    switch (regs->al) {
-    case 7:
-        sercon_putchar(0x07);
-        break;
-    case 8:
-        sercon_lazy_backspace();
-        break;
-    case '\r':
-        sercon_lazy_cr();
-        break;
-    case '\n':
-        sercon_lazy_lf();
-        break;
-    default:
-        sercon_lazy_putchar(regs->al, 0, 1);
-        break;
-    }
+    sercon_teletype(regs->al);
 }
 
 /* Get current video mode */
@@ -506,6 +680,10 @@ handle_sercon(struct bregs *regs)
     case 0x4f: sercon_104f(regs); break;
     default:   sercon_10XX(regs); break;
     }
+
+    // Send the update now (text printed just before the caller halts
+    // or takes over the timer irq must not be lost).
+    sercon_flush_pending();
 }
 
 void sercon_setup(void)
@@ -521,6 +699,13 @@ void sercon_setup(void)
         return;
     dprintf(1, "sercon: using ioport 0x%x\n", addr);
 
+    u16 *grid = malloc_low(SERCON_MAX_ROWS * SERCON_MAX_COLS * sizeof(*grid));
+    if (!grid) {
+        warn_noalloc();
+        return;
+    }
+    SET_LOW(sercon_grid, grid);
+
     if (CONFIG_DEBUG_SERIAL)
         if (addr == CONFIG_DEBUG_SERIAL_PORT)
             ScreenAndDebug = 0;
@@ -541,7 +726,35 @@ void sercon_setup(void)
     SET_IVT(0x10, FUNC16(entry_sercon));
     SET_LOW(sercon_port, addr);
     outb(0x03, addr + SEROFF_LCR); // 8N1
-    outb(0x01, addr + 0x02);       // enable fifo
+    outb(0x01, addr + SEROFF_FCR); // enable fifo
+    u8 fifo = 1;
+    if ((inb(addr + SEROFF_IIR) & 0xc0) == 0xc0
+        && !(CONFIG_DEBUG_SERIAL && addr == CONFIG_DEBUG_SERIAL_PORT))
+        // (debug output may also write to the fifo if the port is shared)
+        fifo = SERIAL_FIFO_SIZE;
+    SET_LOW(sercon_fifo_size, fifo);
+    dprintf(3, "sercon: transmit fifo size %d\n", fifo);
+
+    sercon_grid_fill(SERCON_BLANK);
+    SET_LOW(sercon_dirty, 0);
+}
+
+// Report the serial console output rate.
+void sercon_report(void)
+{
+    if (!CONFIG_SERCON || !GET_LOW(sercon_port))
+        return;
+    dprintf(1, "sercon: sent %u bytes in %u bursts (%u ms waiting on uart"
+            , GET_LOW(sercon_tx_bytes), GET_LOW(sercon_tx_bursts)
+            , GET_LOW(sercon_tx_wait_us) / 1000);
+    u32 bytes = GET_LOW(sercon_tx_busy_bytes);
+    u32 busy_ms = GET_LOW(sercon_tx_busy_us) / 1000;
+    if (busy_ms) {
+        u32 rate = (bytes < 0xffffffff / 1000 ? bytes * 1000 / busy_ms
+                    : bytes / busy_ms * 1000);
+        dprintf(1, ", %u bytes/s", rate);
+    }
+    dprintf(1, ")\n");
 }
 
 /****************************************************************
@@ -635,7 +848,9 @@ sercon_check_event(void)
         return;
 
     // flush pending output
-    sercon_lazy_flush();
+    SET_LOW(sercon_in_tick, 1);
+    sercon_flush_pending();
+    SET_LOW(sercon_in_tick, 0);
 
     // read all available data
     while (inb(addr + SEROFF_LSR) & 0x01) {
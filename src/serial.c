@@ -101,8 +101,9 @@ handle_1401(struct bregs *regs)
     u32 end = irqtimer_calc_ticks(GET_BDA(com_timeout[regs->dx]));
     for (;;) {
         u8 lsr = inb(addr+SEROFF_LSR);
-        if ((lsr & 0x60) == 0x60) {
-            // Success - can write data
+        if (lsr & 0x20) {
+            // Success - the holding register (or fifo) is empty.  The
+            // shift register need not be empty as well.
             outb(regs->al, addr+SEROFF_DATA);
             // XXX - reread lsr?
             regs->ah = lsr;
@@ -167,6 +168,7 @@ void VISIBLE16
 handle_14(struct bregs *regs)
 {
     debug_enter(regs, DEBUG_HDL_14);
+    sampleprof_enter();
     if (! CONFIG_SERIAL) {
         handle_14XX(regs);
         return;
@@ -303,6 +305,7 @@ void VISIBLE16
 handle_17(struct bregs *regs)
 {
     debug_enter(regs, DEBUG_HDL_17);
+    sampleprof_enter();
     if (! CONFIG_LPT) {
         handle_17XX(regs);
         return;
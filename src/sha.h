@@ -8,4 +8,53 @@ void sha256(const u8 *data, u32 length, u8 *hash);
 void sha384(const u8 *data, u32 length, u8 *hash);
 void sha512(const u8 *data, u32 length, u8 *hash);
 
+// State of a hash that is computed in pieces.
+struct sha_ctx {
+    union {
+        u32 h32[8];
+        u64 h64[8];
+    };
+    u32 length; // bytes hashed so far
+    u8 size;    // digest size
+    u8 ext;     // SHAEXT_* extensions in use
+};
+
+void sha1_init(struct sha_ctx *ctx, int ext);
+void sha1_update(struct sha_ctx *ctx, const u8 *data, u32 length);
+void sha1_final(struct sha_ctx *ctx, const u8 *data, u32 length, u8 *hash);
+void sha256_init(struct sha_ctx *ctx, int ext);
+void sha256_update(struct sha_ctx *ctx, const u8 *data, u32 length);
+void sha256_final(struct sha_ctx *ctx, const u8 *data, u32 length, u8 *hash);
+void sha384_init(struct sha_ctx *ctx, int ext);
+void sha512_init(struct sha_ctx *ctx, int ext);
+void sha512_update(struct sha_ctx *ctx, const u8 *data, u32 length);
+void sha512_final(struct sha_ctx *ctx, const u8 *data, u32 length, u8 *hash);
+
+// Vector types for the hardware accelerated code.
+typedef char v16qi __attribute__((vector_size(16)));
+typedef short v8hi __attribute__((vector_size(16)));
+typedef int v4si __attribute__((vector_size(16)));
+typedef long long v2di __attribute__((vector_size(16)));
+typedef unsigned long long v2du __attribute__((vector_size(16)));
+
+#define SHAEXT_TARGET __attribute__((target("sha,sse4.1")))
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+
+// shaext.c
+#define SHAEXT_SHA   (1<<0) // SHA-1/SHA-256 instructions
+#define SHAEXT_SSSE3 (1<<1) // SSSE3 message schedule for SHA-512
+
+struct shaext_s {
+    u32 cr4;
+    u8 xmm[8*16];
+};
+int shaext_begin(struct shaext_s *s, u32 features);
+void shaext_end(struct shaext_s *s);
+void shaext_setup(void);
+
+// sha1.c
+void sha1_blocks_shaext(u32 *h, const u8 *data, u32 count);
+// sha256.c
+void sha256_blocks_shaext(u32 *h, const u8 *data, u32 count);
+
 #endif // sha.h
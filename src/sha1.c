@@ -17,13 +17,8 @@
 #include "string.h" // memcpy
 #include "x86.h" // rol
 
-typedef struct _sha1_ctx {
-    u32 h[5];
-} sha1_ctx;
-
-
 static void
-sha1_block(u32 *w, sha1_ctx *ctx)
+sha1_block(u32 *w, struct sha_ctx *ctx)
 {
     u32 i;
     u32 a,b,c,d,e,f;
@@ -42,11 +37,11 @@ sha1_block(u32 *w, sha1_ctx *ctx)
         w[i] = rol(tmp,1);
     }
 
-    a = ctx->h[0];
-    b = ctx->h[1];
-    c = ctx->h[2];
-    d = ctx->h[3];
-    e = ctx->h[4];
+    a = ctx->h32[0];
+    b = ctx->h32[1];
+    c = ctx->h32[2];
+    d = ctx->h32[3];
+    e = ctx->h32[4];
 
     for (i = 0; i <= 79; i++) {
         if (i <= 19) {
@@ -75,29 +70,125 @@ sha1_block(u32 *w, sha1_ctx *ctx)
         a = tmp;
     }
 
-    ctx->h[0] += a;
-    ctx->h[1] += b;
-    ctx->h[2] += c;
-    ctx->h[3] += d;
-    ctx->h[4] += e;
+    ctx->h32[0] += a;
+    ctx->h32[1] += b;
+    ctx->h32[2] += c;
+    ctx->h32[3] += d;
+    ctx->h32[4] += e;
 }
 
 
+// SHA-1 using the x86 SHA extensions.  The message schedule for
+// rounds i+4 .. i+7 is finished while rounds i .. i+3 execute.
+#define SHA1_LOAD(i)                                                    \
+    ((v4si)__builtin_ia32_pshufb128(                                    \
+         __builtin_ia32_loaddqu((const char*)data + 16*(i)), mask))
+
+#define SHA1_GROUP(i, f, cur, next, prev, prev2) do {                   \
+        if ((i) < 4)                                                    \
+            cur = SHA1_LOAD(i);                                         \
+        e = (i) ? __builtin_ia32_sha1nexte(save, cur) : e0 + cur;       \
+        save = abcd;                                                    \
+        abcd = __builtin_ia32_sha1rnds4(abcd, e, f);                    \
+        if ((i) >= 3 && (i) <= 18)                                      \
+            next = __builtin_ia32_sha1msg2(next, cur);                  \
+        if ((i) >= 1 && (i) <= 16)                                      \
+            prev = __builtin_ia32_sha1msg1(prev, cur);                  \
+        if ((i) >= 2 && (i) <= 17)                                      \
+            prev2 ^= cur;                                               \
+    } while (0)
+
+void SHAEXT_TARGET
+sha1_blocks_shaext(u32 *h, const u8 *data, u32 count)
+{
+    const v16qi mask = { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+    v4si abcd = __builtin_ia32_pshufd(
+        (v4si)__builtin_ia32_loaddqu((const char*)h), 0x1b);
+    v4si e0 = { 0, 0, 0, h[4] };
+
+    while (count--) {
+        v4si m0, m1, m2, m3, e, save = abcd, abcd_save = abcd;
+        SHA1_GROUP(0, 0, m0, m1, m3, m2);
+        SHA1_GROUP(1, 0, m1, m2, m0, m3);
+        SHA1_GROUP(2, 0, m2, m3, m1, m0);
+        SHA1_GROUP(3, 0, m3, m0, m2, m1);
+        SHA1_GROUP(4, 0, m0, m1, m3, m2);
+        SHA1_GROUP(5, 1, m1, m2, m0, m3);
+        SHA1_GROUP(6, 1, m2, m3, m1, m0);
+        SHA1_GROUP(7, 1, m3, m0, m2, m1);
+        SHA1_GROUP(8, 1, m0, m1, m3, m2);
+        SHA1_GROUP(9, 1, m1, m2, m0, m3);
+        SHA1_GROUP(10, 2, m2, m3, m1, m0);
+        SHA1_GROUP(11, 2, m3, m0, m2, m1);
+        SHA1_GROUP(12, 2, m0, m1, m3, m2);
+        SHA1_GROUP(13, 2, m1, m2, m0, m3);
+        SHA1_GROUP(14, 2, m2, m3, m1, m0);
+        SHA1_GROUP(15, 3, m3, m0, m2, m1);
+        SHA1_GROUP(16, 3, m0, m1, m3, m2);
+        SHA1_GROUP(17, 3, m1, m2, m0, m3);
+        SHA1_GROUP(18, 3, m2, m3, m1, m0);
+        SHA1_GROUP(19, 3, m3, m0, m2, m1);
+        e0 = __builtin_ia32_sha1nexte(save, e0);
+        abcd += abcd_save;
+        data += 64;
+    }
+
+    __builtin_ia32_storedqu((char*)h, (v16qi)__builtin_ia32_pshufd(abcd, 0x1b));
+    h[4] = e0[3];
+}
+
+// Process 64-byte blocks ('w' is scratch space for the portable code).
 static void
-sha1_do(sha1_ctx *ctx, const u8 *data32, u32 length)
+sha1_blocks(struct sha_ctx *ctx, const u8 *data, u32 count, u32 *w)
+{
+    if (ctx->ext) {
+        sha1_blocks_shaext(ctx->h32, data, count);
+        return;
+    }
+    while (count--) {
+        if (data != (u8 *)w)
+            memcpy(w, data, 64);
+        sha1_block(w, ctx);
+        data += 64;
+    }
+}
+
+void
+sha1_init(struct sha_ctx *ctx, int ext)
+{
+    ctx->h32[0] = 0x67452301;
+    ctx->h32[1] = 0xefcdab89;
+    ctx->h32[2] = 0x98badcfe;
+    ctx->h32[3] = 0x10325476;
+    ctx->h32[4] = 0xc3d2e1f0;
+    ctx->length = 0;
+    ctx->size = 20;
+    ctx->ext = ext & SHAEXT_SHA;
+}
+
+// Hash whole blocks ('length' must be a multiple of 64 bytes).
+void
+sha1_update(struct sha_ctx *ctx, const u8 *data, u32 length)
+{
+    u32 w[80];
+    sha1_blocks(ctx, data, length / 64, w);
+    ctx->length += length;
+}
+
+// Hash the remaining data and store the digest.
+void
+sha1_final(struct sha_ctx *ctx, const u8 *data32, u32 length, u8 *hash)
 {
     u32 offset;
     u16 num;
-    u32 bits = 0;
+    u32 bits;
     u32 w[80];
     u64 tmp;
 
     /* treat data in 64-byte chunks */
-    for (offset = 0; length - offset >= 64; offset += 64) {
-        memcpy(w, data32 + offset, 64);
-        sha1_block((u32 *)w, ctx);
-        bits += (64 * 8);
-    }
+    offset = length & ~63;
+    sha1_blocks(ctx, data32, length / 64, w);
+    bits = (ctx->length + offset) * 8;
 
     /* last block with less than 64 bytes */
     num = length - offset;
@@ -110,7 +201,7 @@ sha1_do(sha1_ctx *ctx, const u8 *data32, u32 length)
 
     if (num >= 56) {
         /* cannot append number of bits here */
-        sha1_block((u32 *)w, ctx);
+        sha1_blocks(ctx, (u8 *)w, 1, w);
         memset(w, 0x0, 60);
     }
 
@@ -118,11 +209,12 @@ sha1_do(sha1_ctx *ctx, const u8 *data32, u32 length)
     tmp = __swab64(bits);
     memcpy(&w[14], &tmp, 8);
 
-    sha1_block(w, ctx);
+    sha1_blocks(ctx, (u8 *)w, 1, w);
 
     /* need to switch result's endianness */
     for (num = 0; num < 5; num++)
-        ctx->h[num] = cpu_to_be32(ctx->h[num]);
+        ctx->h32[num] = cpu_to_be32(ctx->h32[num]);
+    memcpy(hash, ctx->h32, ctx->size);
 }
 
 
@@ -132,16 +224,10 @@ sha1(const u8 *data, u32 length, u8 *hash)
     if (!CONFIG_TCGBIOS)
         return;
 
-    sha1_ctx ctx = {
-        .h[0] = 0x67452301,
-        .h[1] = 0xefcdab89,
-        .h[2] = 0x98badcfe,
-        .h[3] = 0x10325476,
-        .h[4] = 0xc3d2e1f0,
-    };
-
-    sha1_do(&ctx, data, length);
-    memcpy(hash, &ctx.h[0], 20);
-
-    return;
+    struct shaext_s shaext;
+    struct sha_ctx ctx;
+    sha1_init(&ctx, shaext_begin(&shaext, SHAEXT_SHA));
+    sha1_final(&ctx, data, length, hash);
+    if (ctx.ext)
+        shaext_end(&shaext);
 }
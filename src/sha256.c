@@ -20,10 +20,6 @@
 #include "string.h"
 #include "x86.h"
 
-typedef struct _sha256_ctx {
-    u32 h[8];
-} sha256_ctx;
-
 static inline u32 Ch(u32 x, u32 y, u32 z)
 {
     return (x & y) | ((x ^ 0xffffffff) & z);
@@ -54,34 +50,34 @@ static inline u32 sigma1(u32 x)
     return ror(x, 17) ^ ror(x, 19) ^ (x >> 10);
 }
 
-static void sha256_block(u32 *w, sha256_ctx *ctx)
+/*
+ * FIPS 180-4 4.2.2: SHA256 Constants
+ */
+static const u32 sha_ko[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void sha256_block(u32 *w, struct sha_ctx *ctx)
 {
     u32 t;
     u32 a, b, c, d, e, f, g, h;
     u32 T1, T2;
 
-    /*
-     * FIPS 180-4 4.2.2: SHA256 Constants
-     */
-    static const u32 sha_ko[64] = {
-        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-    };
-
     /*
      * FIPS 180-4 6.2.2: step 1
      *
@@ -101,14 +97,14 @@ static void sha256_block(u32 *w, sha256_ctx *ctx)
     /*
      * step 2: a = H0, b = H1, c = H2, d = H3, e = H4, f = H5, g = H6, h = H7
      */
-    a = ctx->h[0];
-    b = ctx->h[1];
-    c = ctx->h[2];
-    d = ctx->h[3];
-    e = ctx->h[4];
-    f = ctx->h[5];
-    g = ctx->h[6];
-    h = ctx->h[7];
+    a = ctx->h32[0];
+    b = ctx->h32[1];
+    c = ctx->h32[2];
+    d = ctx->h32[3];
+    e = ctx->h32[4];
+    f = ctx->h32[5];
+    g = ctx->h32[6];
+    h = ctx->h32[7];
 
     /*
      * step 3: For i = 0 to 63:
@@ -133,30 +129,139 @@ static void sha256_block(u32 *w, sha256_ctx *ctx)
      * step 4:
      *    H0 = a + H0, H1 = b + H1, H2 = c + H2, H3 = d + H3, H4 = e + H4
      */
-    ctx->h[0] += a;
-    ctx->h[1] += b;
-    ctx->h[2] += c;
-    ctx->h[3] += d;
-    ctx->h[4] += e;
-    ctx->h[5] += f;
-    ctx->h[6] += g;
-    ctx->h[7] += h;
+    ctx->h32[0] += a;
+    ctx->h32[1] += b;
+    ctx->h32[2] += c;
+    ctx->h32[3] += d;
+    ctx->h32[4] += e;
+    ctx->h32[5] += f;
+    ctx->h32[6] += g;
+    ctx->h32[7] += h;
 }
 
-static void sha256_do(sha256_ctx *ctx, const u8 *data32, u32 length)
+/*
+ * SHA-256 using the x86 SHA extensions: the state is kept as ABEF and
+ * CDGH, and each group of four rounds also extends the message schedule.
+ */
+#define SHA256_GROUP(i, cur, n1, n2, n3) do {                           \
+        if ((i) < 4)                                                    \
+            cur = (v4si)__builtin_ia32_pshufb128(                       \
+                __builtin_ia32_loaddqu((const char*)data + 16*(i)), mask); \
+        else                                                            \
+            cur = __builtin_ia32_sha256msg2(                            \
+                __builtin_ia32_sha256msg1(cur, n1)                      \
+                + (v4si)__builtin_ia32_palignr128((v2di)n3, (v2di)n2, 32) \
+                , n3);                                                  \
+        msg = cur + (v4si)__builtin_ia32_loaddqu(                       \
+            (const char*)&sha_ko[4*(i)]);                               \
+        state1 = __builtin_ia32_sha256rnds2(state1, state0, msg);       \
+        state0 = __builtin_ia32_sha256rnds2(                            \
+            state0, state1, __builtin_ia32_pshufd(msg, 0x0e));          \
+    } while (0)
+
+void SHAEXT_TARGET
+sha256_blocks_shaext(u32 *h, const u8 *data, u32 count)
+{
+    const v16qi mask = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+    v4si tmp = __builtin_ia32_pshufd(
+        (v4si)__builtin_ia32_loaddqu((const char*)&h[0]), 0xb1);
+    v4si state1 = __builtin_ia32_pshufd(
+        (v4si)__builtin_ia32_loaddqu((const char*)&h[4]), 0x1b);
+    v4si state0 = (v4si)__builtin_ia32_palignr128(
+        (v2di)tmp, (v2di)state1, 64);                           /* ABEF */
+    state1 = (v4si)__builtin_ia32_pblendw128(
+        (v8hi)state1, (v8hi)tmp, 0xf0);                         /* CDGH */
+
+    while (count--) {
+        v4si m0, m1, m2, m3, msg, save0 = state0, save1 = state1;
+        SHA256_GROUP(0, m0, m1, m2, m3);
+        SHA256_GROUP(1, m1, m2, m3, m0);
+        SHA256_GROUP(2, m2, m3, m0, m1);
+        SHA256_GROUP(3, m3, m0, m1, m2);
+        SHA256_GROUP(4, m0, m1, m2, m3);
+        SHA256_GROUP(5, m1, m2, m3, m0);
+        SHA256_GROUP(6, m2, m3, m0, m1);
+        SHA256_GROUP(7, m3, m0, m1, m2);
+        SHA256_GROUP(8, m0, m1, m2, m3);
+        SHA256_GROUP(9, m1, m2, m3, m0);
+        SHA256_GROUP(10, m2, m3, m0, m1);
+        SHA256_GROUP(11, m3, m0, m1, m2);
+        SHA256_GROUP(12, m0, m1, m2, m3);
+        SHA256_GROUP(13, m1, m2, m3, m0);
+        SHA256_GROUP(14, m2, m3, m0, m1);
+        SHA256_GROUP(15, m3, m0, m1, m2);
+        state0 += save0;
+        state1 += save1;
+        data += 64;
+    }
+
+    tmp = __builtin_ia32_pshufd(state0, 0x1b);                  /* FEBA */
+    state1 = __builtin_ia32_pshufd(state1, 0xb1);               /* DCHG */
+    state0 = (v4si)__builtin_ia32_pblendw128(
+        (v8hi)tmp, (v8hi)state1, 0xf0);                         /* DCBA */
+    state1 = (v4si)__builtin_ia32_palignr128(
+        (v2di)state1, (v2di)tmp, 64);                           /* HGFE */
+    __builtin_ia32_storedqu((char*)&h[0], (v16qi)state0);
+    __builtin_ia32_storedqu((char*)&h[4], (v16qi)state1);
+}
+
+/* process 64-byte blocks; 'w' is scratch space for the portable code */
+static void sha256_blocks(struct sha_ctx *ctx, const u8 *data, u32 count,
+                          u32 *w)
+{
+    if (ctx->ext) {
+        sha256_blocks_shaext(ctx->h32, data, count);
+        return;
+    }
+    while (count--) {
+        if (data != (u8 *)w)
+            memcpy(w, data, 64);
+        sha256_block(w, ctx);
+        data += 64;
+    }
+}
+
+void sha256_init(struct sha_ctx *ctx, int ext)
+{
+    /*
+     * FIPS 180-4: 6.2.1
+     *   -> 5.3.3: initial hash value
+     */
+    ctx->h32[0] = 0x6a09e667;
+    ctx->h32[1] = 0xbb67ae85;
+    ctx->h32[2] = 0x3c6ef372;
+    ctx->h32[3] = 0xa54ff53a;
+    ctx->h32[4] = 0x510e527f;
+    ctx->h32[5] = 0x9b05688c;
+    ctx->h32[6] = 0x1f83d9ab;
+    ctx->h32[7] = 0x5be0cd19;
+    ctx->length = 0;
+    ctx->size = 256/8;
+    ctx->ext = ext & SHAEXT_SHA;
+}
+
+/* hash whole blocks; 'length' must be a multiple of 64 bytes */
+void sha256_update(struct sha_ctx *ctx, const u8 *data, u32 length)
+{
+    u32 w[64];
+
+    sha256_blocks(ctx, data, length / 64, w);
+    ctx->length += length;
+}
+
+/* hash the remaining data and store the digest */
+void sha256_final(struct sha_ctx *ctx, const u8 *data32, u32 length, u8 *hash)
 {
     u32 offset;
     u16 num;
-    u32 bits = 0;
+    u32 bits;
     u32 w[64];
     u64 tmp;
 
     /* treat data in 64-byte chunks */
-    for (offset = 0; length - offset >= 64; offset += 64) {
-        memcpy(w, data32 + offset, 64);
-        sha256_block((u32 *)w, ctx);
-        bits += (64 * 8);
-    }
+    offset = length & ~63;
+    sha256_blocks(ctx, data32, length / 64, w);
+    bits = (ctx->length + offset) * 8;
 
     /* last block with less than 64 bytes */
     num = length - offset;
@@ -172,7 +277,7 @@ static void sha256_do(sha256_ctx *ctx, const u8 *data32, u32 length)
 
     if (num >= 56) {
         /* cannot append number of bits here */
-        sha256_block((u32 *)w, ctx);
+        sha256_blocks(ctx, (u8 *)w, 1, w);
         memset(w, 0, 60);
     }
 
@@ -180,32 +285,21 @@ static void sha256_do(sha256_ctx *ctx, const u8 *data32, u32 length)
     tmp = cpu_to_be64(bits);
     memcpy(&w[14], &tmp, 8);
 
-    sha256_block(w, ctx);
+    sha256_blocks(ctx, (u8 *)w, 1, w);
 
     /* need to switch result's endianness */
     for (num = 0; num < 8; num++)
-        ctx->h[num] = cpu_to_be32(ctx->h[num]);
+        ctx->h32[num] = cpu_to_be32(ctx->h32[num]);
+    memcpy(hash, ctx->h32, ctx->size);
 }
 
 void sha256(const u8 *data, u32 length, u8 *hash)
 {
-    sha256_ctx ctx = {
-        .h = {
-            /*
-             * FIPS 180-4: 6.2.1
-             *   -> 5.3.3: initial hash value
-             */
-            0x6a09e667,
-            0xbb67ae85,
-            0x3c6ef372,
-            0xa54ff53a,
-            0x510e527f,
-            0x9b05688c,
-            0x1f83d9ab,
-            0x5be0cd19
-        }
-    };
-
-    sha256_do(&ctx, data, length);
-    memcpy(hash, ctx.h, sizeof(ctx.h));
+    struct shaext_s shaext;
+    struct sha_ctx ctx;
+
+    sha256_init(&ctx, shaext_begin(&shaext, SHAEXT_SHA));
+    sha256_final(&ctx, data, length, hash);
+    if (ctx.ext)
+        shaext_end(&shaext);
 }
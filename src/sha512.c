@@ -19,10 +19,6 @@
 #include "sha.h"
 #include "string.h"
 
-typedef struct _sha512_ctx {
-    u64 h[8];
-} sha512_ctx;
-
 static inline u64 ror64(u64 x, u8 n)
 {
     return (x >> n) | (x << (64 - n));
@@ -58,7 +54,33 @@ static inline u64 sigma1_64(u64 x)
     return ror64(x, 19) ^ ror64(x, 61) ^ (x >> 6);
 }
 
-static void sha512_block(u64 *w, sha512_ctx *ctx)
+#define ROR64X2(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+/*
+ * Byte swap the message and expand the schedule two words at a time
+ * using the SSE2 64-bit operations (and the SSSE3 pshufb).
+ */
+static void SSSE3_TARGET sha512_schedule_ssse3(u64 *w)
+{
+    const v16qi mask = { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 };
+    u32 t;
+
+    for (t = 0; t <= 15; t += 2)
+        __builtin_ia32_storedqu((char *)&w[t], __builtin_ia32_pshufb128(
+            __builtin_ia32_loaddqu((char *)&w[t]), mask));
+
+    for (t = 16; t <= 79; t += 2) {
+        v2du w2 = (v2du)__builtin_ia32_loaddqu((char *)&w[t-2]);
+        v2du w7 = (v2du)__builtin_ia32_loaddqu((char *)&w[t-7]);
+        v2du w15 = (v2du)__builtin_ia32_loaddqu((char *)&w[t-15]);
+        v2du w16 = (v2du)__builtin_ia32_loaddqu((char *)&w[t-16]);
+        v2du s1 = ROR64X2(w2, 19) ^ ROR64X2(w2, 61) ^ (w2 >> 6);
+        v2du s0 = ROR64X2(w15, 1) ^ ROR64X2(w15, 8) ^ (w15 >> 7);
+        __builtin_ia32_storedqu((char *)&w[t], (v16qi)(s1 + w7 + s0 + w16));
+    }
+}
+
+static void sha512_block(u64 *w, struct sha_ctx *ctx)
 {
     u32 t;
     u64 a, b, c, d, e, f, g, h;
@@ -100,23 +122,28 @@ static void sha512_block(u64 *w, sha512_ctx *ctx)
      */
 
     /* w(0)..w(15) are in big endian format */
-    for (t = 0; t <= 15; t++)
-        w[t] = be64_to_cpu(w[t]);
+    if (ctx->ext) {
+        sha512_schedule_ssse3(w);
+    } else {
+        for (t = 0; t <= 15; t++)
+            w[t] = be64_to_cpu(w[t]);
 
-    for (t = 16; t <= 79; t++)
-        w[t] = sigma1_64(w[t-2]) + w[t-7] + sigma0_64(w[t-15]) + w[t-16];
+        for (t = 16; t <= 79; t++)
+            w[t] = sigma1_64(w[t-2]) + w[t-7] + sigma0_64(w[t-15])
+                   + w[t-16];
+    }
 
     /*
      * step 2: a = H0, b = H1, c = H2, d = H3, e = H4, f = H5, g = H6, h = H7
      */
-    a = ctx->h[0];
-    b = ctx->h[1];
-    c = ctx->h[2];
-    d = ctx->h[3];
-    e = ctx->h[4];
-    f = ctx->h[5];
-    g = ctx->h[6];
-    h = ctx->h[7];
+    a = ctx->h64[0];
+    b = ctx->h64[1];
+    c = ctx->h64[2];
+    d = ctx->h64[3];
+    e = ctx->h64[4];
+    f = ctx->h64[5];
+    g = ctx->h64[6];
+    h = ctx->h64[7];
 
     /*
      * step 3: For i = 0 to 79:
@@ -141,21 +168,73 @@ static void sha512_block(u64 *w, sha512_ctx *ctx)
      * step 4:
      *    H0 = a + H0, H1 = b + H1, H2 = c + H2, H3 = d + H3, H4 = e + H4
      */
-    ctx->h[0] += a;
-    ctx->h[1] += b;
-    ctx->h[2] += c;
-    ctx->h[3] += d;
-    ctx->h[4] += e;
-    ctx->h[5] += f;
-    ctx->h[6] += g;
-    ctx->h[7] += h;
+    ctx->h64[0] += a;
+    ctx->h64[1] += b;
+    ctx->h64[2] += c;
+    ctx->h64[3] += d;
+    ctx->h64[4] += e;
+    ctx->h64[5] += f;
+    ctx->h64[6] += g;
+    ctx->h64[7] += h;
+}
+
+void sha384_init(struct sha_ctx *ctx, int ext)
+{
+    /*
+     * FIPS 180-4: 6.2.1
+     *   -> 5.3.4: initial hash value
+     */
+    ctx->h64[0] = 0xcbbb9d5dc1059ed8;
+    ctx->h64[1] = 0x629a292a367cd507;
+    ctx->h64[2] = 0x9159015a3070dd17;
+    ctx->h64[3] = 0x152fecd8f70e5939;
+    ctx->h64[4] = 0x67332667ffc00b31;
+    ctx->h64[5] = 0x8eb44a8768581511;
+    ctx->h64[6] = 0xdb0c2e0d64f98fa7;
+    ctx->h64[7] = 0x47b5481dbefa4fa4;
+    ctx->length = 0;
+    ctx->size = 384/8;
+    ctx->ext = ext & SHAEXT_SSSE3;
+}
+
+void sha512_init(struct sha_ctx *ctx, int ext)
+{
+    /*
+     * FIPS 180-4: 6.2.1
+     *   -> 5.3.5: initial hash value
+     */
+    ctx->h64[0] = 0x6a09e667f3bcc908;
+    ctx->h64[1] = 0xbb67ae8584caa73b;
+    ctx->h64[2] = 0x3c6ef372fe94f82b;
+    ctx->h64[3] = 0xa54ff53a5f1d36f1;
+    ctx->h64[4] = 0x510e527fade682d1;
+    ctx->h64[5] = 0x9b05688c2b3e6c1f;
+    ctx->h64[6] = 0x1f83d9abfb41bd6b;
+    ctx->h64[7] = 0x5be0cd19137e2179;
+    ctx->length = 0;
+    ctx->size = 512/8;
+    ctx->ext = ext & SHAEXT_SSSE3;
+}
+
+/* hash whole blocks; 'length' must be a multiple of 128 bytes */
+void sha512_update(struct sha_ctx *ctx, const u8 *data, u32 length)
+{
+    u32 offset;
+    u64 w[80];
+
+    for (offset = 0; offset < length; offset += 128) {
+        memcpy(w, data + offset, 128);
+        sha512_block(w, ctx);
+    }
+    ctx->length += length;
 }
 
-static void sha512_do(sha512_ctx *ctx, const u8 *data32, u32 length)
+/* hash the remaining data and store the digest (SHA-384 or SHA-512) */
+void sha512_final(struct sha_ctx *ctx, const u8 *data32, u32 length, u8 *hash)
 {
     u32 offset;
     u16 num;
-    u64 bits = 0;
+    u64 bits;
     u64 w[80];
     u64 tmp;
 
@@ -163,8 +242,8 @@ static void sha512_do(sha512_ctx *ctx, const u8 *data32, u32 length)
     for (offset = 0; length - offset >= 128; offset += 128) {
         memcpy(w, data32 + offset, 128);
         sha512_block(w, ctx);
-        bits += (128 * 8);
     }
+    bits = (u64)(ctx->length + offset) << 3;
 
     /* last block with less than 128 bytes */
     num = length - offset;
@@ -194,51 +273,28 @@ static void sha512_do(sha512_ctx *ctx, const u8 *data32, u32 length)
 
     /* need to switch result's endianness */
     for (num = 0; num < 8; num++)
-        ctx->h[num] = cpu_to_be64(ctx->h[num]);
+        ctx->h64[num] = cpu_to_be64(ctx->h64[num]);
+    memcpy(hash, ctx->h64, ctx->size);
 }
 
 void sha384(const u8 *data, u32 length, u8 *hash)
 {
-    sha512_ctx ctx = {
-        .h = {
-            /*
-             * FIPS 180-4: 6.2.1
-             *   -> 5.3.4: initial hash value
-             */
-            0xcbbb9d5dc1059ed8,
-            0x629a292a367cd507,
-            0x9159015a3070dd17,
-            0x152fecd8f70e5939,
-            0x67332667ffc00b31,
-            0x8eb44a8768581511,
-            0xdb0c2e0d64f98fa7,
-            0x47b5481dbefa4fa4
-        }
-    };
+    struct shaext_s shaext;
+    struct sha_ctx ctx;
 
-    sha512_do(&ctx, data, length);
-    memcpy(hash, ctx.h, 384/8);
+    sha384_init(&ctx, shaext_begin(&shaext, SHAEXT_SSSE3));
+    sha512_final(&ctx, data, length, hash);
+    if (ctx.ext)
+        shaext_end(&shaext);
 }
 
 void sha512(const u8 *data, u32 length, u8 *hash)
 {
-    sha512_ctx ctx = {
-        .h = {
-            /*
-             * FIPS 180-4: 6.2.1
-             *   -> 5.3.5: initial hash value
-             */
-            0x6a09e667f3bcc908,
-            0xbb67ae8584caa73b,
-            0x3c6ef372fe94f82b,
-            0xa54ff53a5f1d36f1,
-            0x510e527fade682d1,
-            0x9b05688c2b3e6c1f,
-            0x1f83d9abfb41bd6b,
-            0x5be0cd19137e2179
-        }
-    };
+    struct shaext_s shaext;
+    struct sha_ctx ctx;
 
-    sha512_do(&ctx, data, length);
-    memcpy(hash, ctx.h, sizeof(ctx.h));
+    sha512_init(&ctx, shaext_begin(&shaext, SHAEXT_SSSE3));
+    sha512_final(&ctx, data, length, hash);
+    if (ctx.ext)
+        shaext_end(&shaext);
 }
@@ -0,0 +1,142 @@
+// Support for hardware accelerated SHA (x86 SHA and SSSE3 extensions).
+//
+// This file may be distributed under the terms of the GNU LGPLv3 license.
+
+#include "config.h" // CONFIG_TCGBIOS
+#include "output.h" // dprintf
+#include "sha.h" // shaext_begin
+#include "string.h" // memcmp
+#include "x86.h" // cpuid
+
+#define CPUID_FXSR   (1 << 24) // edx of leaf 1
+#define CPUID_SSE2   (1 << 26) // edx of leaf 1
+#define CPUID_SSSE3  (1 << 9)  // ecx of leaf 1
+#define CPUID_SSE41  (1 << 19) // ecx of leaf 1
+#define CPUID_SHA    (1 << 29) // ebx of leaf 7
+
+// Extensions available (and verified) on this cpu.
+static u32 ShaExtFeatures;
+
+// Prepare to use the SSE registers.  Returns the subset of the
+// requested extensions that may be used - if zero, the portable code
+// should be used and shaext_end() must not be called.
+int
+shaext_begin(struct shaext_s *s, u32 features)
+{
+    features &= ShaExtFeatures;
+    if (!features || cr0_read() & (CR0_EM|CR0_TS))
+        return 0;
+    s->cr4 = cr4_read();
+    if (s->cr4 & CR4_OSFXSR) {
+        // SSE already enabled by someone else - preserve their state.
+        asm volatile(
+            "movdqu %%xmm0, 0x00(%0)\n  movdqu %%xmm1, 0x10(%0)\n"
+            "movdqu %%xmm2, 0x20(%0)\n  movdqu %%xmm3, 0x30(%0)\n"
+            "movdqu %%xmm4, 0x40(%0)\n  movdqu %%xmm5, 0x50(%0)\n"
+            "movdqu %%xmm6, 0x60(%0)\n  movdqu %%xmm7, 0x70(%0)\n"
+            : : "r" (s->xmm) : "memory");
+        return features;
+    }
+    cr4_write(s->cr4 | CR4_OSFXSR);
+    return features;
+}
+
+void
+shaext_end(struct shaext_s *s)
+{
+    if (!(s->cr4 & CR4_OSFXSR)) {
+        cr4_write(s->cr4);
+        return;
+    }
+    asm volatile(
+        "movdqu 0x00(%0), %%xmm0\n  movdqu 0x10(%0), %%xmm1\n"
+        "movdqu 0x20(%0), %%xmm2\n  movdqu 0x30(%0), %%xmm3\n"
+        "movdqu 0x40(%0), %%xmm4\n  movdqu 0x50(%0), %%xmm5\n"
+        "movdqu 0x60(%0), %%xmm6\n  movdqu 0x70(%0), %%xmm7\n"
+        : : "r" (s->xmm) : "memory");
+}
+
+// Known answers for the two block message of FIPS 180-4 / RFC 6234.
+static const char ShaTestMsg[] =
+    "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+    "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+
+static const u8 ShaTestSha1[20] = {
+    0xa4, 0x9b, 0x24, 0x46, 0xa0, 0x2c, 0x64, 0x5b, 0xf4, 0x19,
+    0xf9, 0x95, 0xb6, 0x70, 0x91, 0x25, 0x3a, 0x04, 0xa2, 0x59
+};
+
+static const u8 ShaTestSha256[32] = {
+    0xcf, 0x5b, 0x16, 0xa7, 0x78, 0xaf, 0x83, 0x80,
+    0x03, 0x6c, 0xe5, 0x9e, 0x7b, 0x04, 0x92, 0x37,
+    0x0b, 0x24, 0x9b, 0x11, 0xe8, 0xf0, 0x7a, 0x51,
+    0xaf, 0xac, 0x45, 0x03, 0x7a, 0xfe, 0xe9, 0xd1
+};
+
+static const u8 ShaTestSha512[64] = {
+    0x8e, 0x95, 0x9b, 0x75, 0xda, 0xe3, 0x13, 0xda,
+    0x8c, 0xf4, 0xf7, 0x28, 0x14, 0xfc, 0x14, 0x3f,
+    0x8f, 0x77, 0x79, 0xc6, 0xeb, 0x9f, 0x7f, 0xa1,
+    0x72, 0x99, 0xae, 0xad, 0xb6, 0x88, 0x90, 0x18,
+    0x50, 0x1d, 0x28, 0x9e, 0x49, 0x00, 0xf7, 0xe4,
+    0x33, 0x1b, 0x99, 0xde, 0xc4, 0xb5, 0x43, 0x3a,
+    0xc7, 0xd3, 0x29, 0xee, 0xb6, 0xdd, 0x26, 0x54,
+    0x5e, 0x96, 0xe5, 0x5b, 0x87, 0x4b, 0xe9, 0x09
+};
+
+// Run a known answer test on the accelerated code.
+static int
+shaext_selftest(void (*func)(const u8 *data, u32 length, u8 *hash)
+                , const u8 *digest, int size)
+{
+    u8 hash[64];
+    func((u8*)ShaTestMsg, sizeof(ShaTestMsg) - 1, hash);
+    return memcmp(hash, digest, size);
+}
+
+static inline void
+cpuid_subleaf(u32 index, u32 *eax, u32 *ebx, u32 *ecx, u32 *edx)
+{
+    asm("cpuid"
+        : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+        : "0" (index), "2" (0));
+}
+
+void
+shaext_setup(void)
+{
+    if (!CONFIG_TCGBIOS)
+        return;
+    u32 max, eax, ebx, ecx, edx, features = 0;
+    cpuid(0, &max, &ebx, &ecx, &edx);
+    if (max < 1)
+        return;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if ((edx & (CPUID_FXSR|CPUID_SSE2)) != (CPUID_FXSR|CPUID_SSE2)
+        || !(ecx & CPUID_SSSE3))
+        return;
+    features |= SHAEXT_SSSE3;
+    if (max >= 7 && ecx & CPUID_SSE41) {
+        u32 ecx7;
+        cpuid_subleaf(7, &eax, &ebx, &ecx7, &edx);
+        if (ebx & CPUID_SHA)
+            features |= SHAEXT_SHA;
+    }
+
+    ShaExtFeatures = features;
+    if (features & SHAEXT_SHA
+        && (shaext_selftest(sha1, ShaTestSha1, sizeof(ShaTestSha1))
+            || shaext_selftest(sha256, ShaTestSha256
+                               , sizeof(ShaTestSha256)))) {
+        dprintf(1, "sha: SHA extension self test failed\n");
+        features &= ~SHAEXT_SHA;
+    }
+    if (shaext_selftest(sha512, ShaTestSha512, sizeof(ShaTestSha512))) {
+        dprintf(1, "sha: SSSE3 SHA-512 self test failed\n");
+        features &= ~SHAEXT_SSSE3;
+    }
+    ShaExtFeatures = features;
+    dprintf(3, "sha: using%s%s\n"
+            , features & SHAEXT_SHA ? " sha-ni" : ""
+            , features & SHAEXT_SSSE3 ? " ssse3-sha512" : "");
+}
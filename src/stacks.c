@@ -486,6 +486,20 @@ have_threads(void)
             && GET_FLATPTR(MainThread.node.next) != &MainThread.node);
 }
 
+// Return the number of threads (including the main thread).
+int
+thread_count(void)
+{
+    ASSERT32FLAT();
+    int count = 1;
+    struct hlist_node *n = MainThread.node.next;
+    while (n != &MainThread.node) {
+        count++;
+        n = n->next;
+    }
+    return count;
+}
+
 // Return the 'struct thread_info' for the currently running thread.
 struct thread_info *
 getCurThread(void)
@@ -624,6 +638,7 @@ check_irqs(void)
 void
 yield(void)
 {
+    sampleprof_yield(__builtin_return_address(0));
     if (MODESEGMENT || !CONFIG_THREADS) {
         check_irqs();
         return;
@@ -40,6 +40,7 @@ void yield(void);
 void yield_toirq(void);
 void thread_setup(void);
 int threads_during_optionroms(void);
+int thread_count(void);
 void run_thread(void (*func)(void*), void *data);
 void wait_threads(void);
 struct mutex_s { u32 isLocked; };
@@ -335,6 +335,7 @@ void VISIBLE16
 handle_15(struct bregs *regs)
 {
     debug_enter(regs, DEBUG_HDL_15);
+    sampleprof_enter();
     switch (regs->ah) {
     case 0x24: handle_1524(regs); break;
     case 0x4f: handle_154f(regs); break;
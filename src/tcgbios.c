@@ -14,9 +14,10 @@
 #include "config.h" // CONFIG_TCGBIOS
 #include "farptr.h" // MAKE_FLATPTR
 #include "fw/paravirt.h" // runningOnXen
+#include "fw/smp.h" // smp_job_start, smp_memset
 #include "hw/tpm_drivers.h" // tpm_drivers[]
 #include "output.h" // dprintf
-#include "sha.h" // sha1, sha256, ...
+#include "sha.h" // sha1, sha256, shaext_setup, ...
 #include "std/acpi.h"  // RSDP_SIGNATURE, rsdt_descriptor
 #include "std/smbios.h" // struct smbios_21_entry_point
 #include "std/tcg.h" // TCG_PC_LOGOVERFLOW
@@ -54,7 +55,7 @@ static int tpm_set_log_area(u8 *log_area_start_address,
     if (!log_area_start_address || !log_area_minimum_length)
         return -1;
 
-    memset(log_area_start_address, 0, log_area_minimum_length);
+    smp_memset(log_area_start_address, 0, log_area_minimum_length);
     tpm_state.log_area_start_address = log_area_start_address;
     tpm_state.log_area_minimum_length = log_area_minimum_length;
     tpm_state.log_area_next_entry = log_area_start_address;
@@ -167,32 +168,43 @@ static const struct hash_parameters {
     u8  hashalg_flag;
     u8  hash_buffersize;
     const char *name;
-    void (*hashfunc)(const u8 *data, u32 length, u8 *hash);
+    void (*hashinit)(struct sha_ctx *ctx, int ext);
+    void (*hashupdate)(struct sha_ctx *ctx, const u8 *data, u32 length);
+    void (*hashfinal)(struct sha_ctx *ctx, const u8 *data, u32 length
+                      , u8 *hash);
 } hash_parameters[] = {
     {
         .hashalg = TPM2_ALG_SHA1,
         .hashalg_flag = TPM2_ALG_SHA1_FLAG,
         .hash_buffersize = SHA1_BUFSIZE,
         .name = "SHA1",
-        .hashfunc = sha1,
+        .hashinit = sha1_init,
+        .hashupdate = sha1_update,
+        .hashfinal = sha1_final,
     }, {
         .hashalg = TPM2_ALG_SHA256,
         .hashalg_flag = TPM2_ALG_SHA256_FLAG,
         .hash_buffersize = SHA256_BUFSIZE,
         .name = "SHA256",
-        .hashfunc = sha256,
+        .hashinit = sha256_init,
+        .hashupdate = sha256_update,
+        .hashfinal = sha256_final,
     }, {
         .hashalg = TPM2_ALG_SHA384,
         .hashalg_flag = TPM2_ALG_SHA384_FLAG,
         .hash_buffersize = SHA384_BUFSIZE,
         .name = "SHA384",
-        .hashfunc = sha384,
+        .hashinit = sha384_init,
+        .hashupdate = sha512_update,
+        .hashfinal = sha512_final,
     }, {
         .hashalg = TPM2_ALG_SHA512,
         .hashalg_flag = TPM2_ALG_SHA512_FLAG,
         .hash_buffersize = SHA512_BUFSIZE,
         .name = "SHA512",
-        .hashfunc = sha512,
+        .hashinit = sha512_init,
+        .hashupdate = sha512_update,
+        .hashfinal = sha512_final,
     }, {
         .hashalg = TPM2_ALG_SM3_256,
         .hashalg_flag = TPM2_ALG_SM3_256_FLAG,
@@ -264,19 +276,53 @@ tpm20_hashalg_flag_to_name(u8 hashalg_flag)
     return NULL;
 }
 
-static void tpm2_hash_data(u16 hashAlg, const u8 *data, u32 data_len, u8 *hash)
+static const struct hash_parameters *
+tpm20_find_hash(u16 hashAlg)
 {
     unsigned i;
 
     for (i = 0; i < ARRAY_SIZE(hash_parameters); i++) {
-        if (hash_parameters[i].hashalg == hashAlg) {
-            if (hash_parameters[i].hashfunc) {
-                hash_parameters[i].hashfunc(data, data_len, hash);
-            } else {
-                memset(hash, 0xff, hash_parameters[i].hash_buffersize);
-            }
-        }
+        if (hash_parameters[i].hashalg == hashAlg)
+            return &hash_parameters[i];
     }
+    return NULL;
+}
+
+// Number of banks that can be hashed (those with a hashinit function)
+#define TPM2_HASH_MAX 4
+// Bytes fed to each bank in turn (a multiple of all the block sizes)
+#define TPM2_HASH_CHUNK 4096
+
+struct tpm2_hash_s {
+    const struct hash_parameters *hp;
+    u8 *hash;
+    struct sha_ctx ctx;
+};
+
+// Hash data for several banks in a single pass - each chunk of the
+// data is fed to all the banks while it is still in the cpu cache.
+static void
+tpm2_hash_data(struct tpm2_hash_s *hashes, int count
+               , const u8 *data, u32 data_len)
+{
+    struct shaext_s shaext;
+    int ext = shaext_begin(&shaext, SHAEXT_SHA | SHAEXT_SSSE3);
+    int i;
+    for (i = 0; i < count; i++)
+        hashes[i].hp->hashinit(&hashes[i].ctx, ext);
+
+    u32 offset;
+    for (offset = 0; data_len - offset > TPM2_HASH_CHUNK
+             ; offset += TPM2_HASH_CHUNK)
+        for (i = 0; i < count; i++)
+            hashes[i].hp->hashupdate(&hashes[i].ctx, data + offset
+                                     , TPM2_HASH_CHUNK);
+    for (i = 0; i < count; i++)
+        hashes[i].hp->hashfinal(&hashes[i].ctx, data + offset
+                                , data_len - offset, hashes[i].hash);
+
+    if (ext)
+        shaext_end(&shaext);
 }
 
 // Add an entry at the start of the log describing digest formats
@@ -379,6 +425,8 @@ tpm20_build_digest(struct tpm_log_entry *le,
     struct tpms_pcr_selection *sel = tpm20_pcr_selection->selections;
     void *nsel, *end = (void*)tpm20_pcr_selection + tpm20_pcr_selection_size;
     void *dest = le->hdr.digest + sizeof(struct tpm2_digest_values);
+    struct tpm2_hash_s hashes[TPM2_HASH_MAX];
+    int numHashes = 0;
 
     u32 count, numAlgs = 0;
     for (count = 0; count < be32_to_cpu(tpm20_pcr_selection->count); count++) {
@@ -394,12 +442,14 @@ tpm20_build_digest(struct tpm_log_entry *le,
             continue;
         }
 
-        int hsize = tpm20_get_hash_buffersize(be16_to_cpu(sel->hashAlg));
-        if (hsize < 0) {
+        const struct hash_parameters *hp;
+        hp = tpm20_find_hash(be16_to_cpu(sel->hashAlg));
+        if (!hp) {
             dprintf(DEBUG_tcg, "TPM is using an unsupported hash: %d\n",
                     be16_to_cpu(sel->hashAlg));
             return -1;
         }
+        int hsize = hp->hash_buffersize;
 
         /* buffer size sanity check before writing */
         struct tpm2_digest_value *v = dest;
@@ -413,8 +463,17 @@ tpm20_build_digest(struct tpm_log_entry *le,
         else
             v->hashAlg = be16_to_cpu(sel->hashAlg);
 
-        tpm2_hash_data(be16_to_cpu(sel->hashAlg), hashdata, hashdata_len,
-                       v->hash);
+        if (!hp->hashinit) {
+            memset(v->hash, 0xff, hsize);
+        } else {
+            if (numHashes >= ARRAY_SIZE(hashes)) {
+                dprintf(DEBUG_tcg, "TPM has too many active PCR banks\n");
+                return -1;
+            }
+            hashes[numHashes].hp = hp;
+            hashes[numHashes].hash = v->hash;
+            numHashes++;
+        }
 
         dest += sizeof(*v) + hsize;
         sel = nsel;
@@ -427,6 +486,8 @@ tpm20_build_digest(struct tpm_log_entry *le,
         return -1;
     }
 
+    tpm2_hash_data(hashes, numHashes, hashdata, hashdata_len);
+
     struct tpm2_digest_values *v = (void*)le->hdr.digest;
     if (bigEndian)
         v->count = cpu_to_be32(numAlgs);
@@ -465,6 +526,25 @@ tpm_build_digest(struct tpm_log_entry *le, const u8 *hashdata, u32 hashdata_len
     return -1;
 }
 
+// Convert a digest built in big endian format for the TPM to the
+// little endian format of the log (without hashing the data again).
+static void
+tpm_digest_to_log(struct tpm_log_entry *le)
+{
+    if (TPM_version != TPM_VERSION_2)
+        return;
+    struct tpm2_digest_values *v = (void*)le->hdr.digest;
+    void *dest = le->hdr.digest + sizeof(*v);
+    u32 count = be32_to_cpu(v->count);
+    v->count = count;
+    while (count--) {
+        struct tpm2_digest_value *d = dest;
+        u16 hashAlg = be16_to_cpu(d->hashAlg);
+        d->hashAlg = hashAlg;
+        dest += sizeof(*d) + tpm20_get_hash_buffersize(hashAlg);
+    }
+}
+
 
 /****************************************************************
  * TPM hardware command wrappers
@@ -1003,9 +1083,9 @@ tpm_set_failure(void)
  *  hashdata_length: length of the data to be hashed
  */
 static void
-tpm_add_measurement_to_log(u32 pcrindex, u32 event_type,
-                           const char *event, u32 event_length,
-                           const u8 *hashdata, u32 hashdata_length)
+__tpm_add_measurement_to_log(u32 pcrindex, u32 event_type,
+                             const char *event, u32 event_length,
+                             const u8 *hashdata, u32 hashdata_length)
 {
     if (!tpm_is_working())
         return;
@@ -1022,10 +1102,59 @@ tpm_add_measurement_to_log(u32 pcrindex, u32 event_type,
         tpm_set_failure();
         return;
     }
-    tpm_build_digest(&le, hashdata, hashdata_length, 0);
+    tpm_digest_to_log(&le);
     tpm_log_event(&le.hdr, digest_len, event, event_length);
 }
 
+// Option rom measurements queued during POST.  The rom is hashed from
+// a copy (possibly on an idle AP) while the rom itself runs, and the
+// extends and log entries are done later in the order they were queued.
+struct tpm_pending_rom {
+    struct tpm_pending_rom *next;
+    struct smp_job job;
+    const u8 *data;
+    u32 len;
+    struct pcctes_romex pcctes;
+};
+
+static struct tpm_pending_rom *TPMPendingRoms, *TPMPendingRomsLast;
+
+static void
+tpm_option_rom_hash(void *data)
+{
+    struct tpm_pending_rom *p = data;
+    sha1(p->data, p->len, p->pcctes.digest);
+}
+
+// Extend and log all queued option rom measurements.  (The queue
+// entries are temporary memory released at boot - they are not freed
+// here as this is also reachable from the runtime int 1a handler.)
+static void
+tpm_option_rom_flush(void)
+{
+    while (TPMPendingRoms) {
+        struct tpm_pending_rom *p = TPMPendingRoms;
+        smp_job_wait(&p->job);
+        TPMPendingRoms = p->next;
+        __tpm_add_measurement_to_log(2, EV_EVENT_TAG,
+                                     (const char *)&p->pcctes,
+                                     sizeof(p->pcctes),
+                                     (u8 *)&p->pcctes, sizeof(p->pcctes));
+    }
+    TPMPendingRomsLast = NULL;
+}
+
+// Extend a measurement (after any queued ones) and add it to the log.
+static void
+tpm_add_measurement_to_log(u32 pcrindex, u32 event_type,
+                           const char *event, u32 event_length,
+                           const u8 *hashdata, u32 hashdata_length)
+{
+    tpm_option_rom_flush();
+    __tpm_add_measurement_to_log(pcrindex, event_type, event, event_length
+                                 , hashdata, hashdata_length);
+}
+
 // Add an EV_ACTION measurement to the list of measurements
 static void
 tpm_add_action(u32 pcrIndex, const char *string)
@@ -1225,6 +1354,7 @@ tpm_setup(void)
              (TPM_version == TPM_VERSION_1_2) ? "1.2" : "2");
 
     TPM_working = 1;
+    shaext_setup();
 
     if (runningOnXen())
         return;
@@ -1267,6 +1397,9 @@ tpm_prepboot(void)
     if (!CONFIG_TCGBIOS)
         return;
 
+    // Complete the option rom measurements before leaving the BIOS.
+    tpm_option_rom_flush();
+
     switch (TPM_version) {
     case TPM_VERSION_1_2:
         if (TPM_has_physical_presence)
@@ -1280,6 +1413,8 @@ tpm_prepboot(void)
 
     tpm_add_action(4, "Calling INT 19h");
     tpm_add_event_separators();
+
+    tpmhw_report();
 }
 
 /*
@@ -1291,15 +1426,36 @@ tpm_option_rom(const void *addr, u32 len)
     if (!tpm_is_working())
         return;
 
-    struct pcctes_romex pcctes = {
-        .eventid = 7,
-        .eventdatasize = sizeof(u16) + sizeof(u16) + SHA1_BUFSIZE,
-    };
-    sha1((const u8 *)addr, len, pcctes.digest);
-    tpm_add_measurement_to_log(2,
-                               EV_EVENT_TAG,
-                               (const char *)&pcctes, sizeof(pcctes),
-                               (u8 *)&pcctes, sizeof(pcctes));
+    // Hash a copy of the rom if it can be done while the rom runs.
+    int async = smp_job_async();
+    struct tpm_pending_rom *p = malloc_tmphigh(sizeof(*p) + (async ? len : 0));
+    if (!p) {
+        struct pcctes_romex pcctes = {
+            .eventid = 7,
+            .eventdatasize = sizeof(u16) + sizeof(u16) + SHA1_BUFSIZE,
+        };
+        sha1((const u8 *)addr, len, pcctes.digest);
+        tpm_add_measurement_to_log(2,
+                                   EV_EVENT_TAG,
+                                   (const char *)&pcctes, sizeof(pcctes),
+                                   (u8 *)&pcctes, sizeof(pcctes));
+        return;
+    }
+    memset(p, 0, sizeof(*p));
+    p->pcctes.eventid = 7;
+    p->pcctes.eventdatasize = sizeof(u16) + sizeof(u16) + SHA1_BUFSIZE;
+    p->data = addr;
+    p->len = len;
+    if (async) {
+        memcpy(&p[1], addr, len);
+        p->data = (void*)&p[1];
+    }
+    if (TPMPendingRomsLast)
+        TPMPendingRomsLast->next = p;
+    else
+        TPMPendingRoms = p;
+    TPMPendingRomsLast = p;
+    smp_job_start(&p->job, tpm_option_rom_hash, p);
 }
 
 void
@@ -1656,6 +1812,8 @@ tpm_interrupt_handler32(struct bregs *regs)
     if (!CONFIG_TCGBIOS)
         return;
 
+    tpm_option_rom_flush();
+
     set_cf(regs, 0);
 
     if (TPM_interface_shutdown && regs->al) {
@@ -107,12 +107,13 @@ int acpi_dsdt_find_irq(struct acpi_device *dev, u64 *irq);
 // fw/coreboot.c
 extern const char *CBvendor, *CBpart;
 struct cbfs_file;
-void coreboot_debug_putc(char c);
+void coreboot_debug_putbuf(const char *buf, int len);
 void cbfs_run_payload(struct cbfs_file *file);
 void coreboot_platform_setup(void);
 void cbfs_payload_setup(void);
 void coreboot_preinit(void);
 void coreboot_cbfs_init(void);
+void cbfs_report(void);
 struct cb_header;
 void *find_cb_subtable(struct cb_header *cbh, u32 tag);
 struct cb_header *find_cb_table(void);
@@ -122,6 +123,10 @@ int csm_bootprio_fdc(struct pci_device *pci, int port, int fdid);
 int csm_bootprio_ata(struct pci_device *pci, int chanid, int slave);
 int csm_bootprio_pci(struct pci_device *pci);
 
+// fw/logring.c
+void logring_putbuf(const char *buf, int len);
+void logring_setup(void);
+
 // fw/mptable.c
 void mptable_setup(void);
 
@@ -175,6 +180,7 @@ void floppy_tick(void);
 // hw/ramdisk.c
 void ramdisk_setup(void);
 int ramdisk_process_op(struct disk_op_s *op);
+int ramdisk_lzb_process_op(struct disk_op_s *op);
 
 // hw/sdcard.c
 int sdcard_process_op(struct disk_op_s *op);
@@ -182,11 +188,14 @@ void sdcard_setup(void);
 
 // hw/timer.c
 void timer_setup(void);
+void tsctimer_probe(void);
 void pmtimer_setup(u16 ioport);
 void tsctimer_setfreq(u32 khz, const char *src);
 u32 timer_calc(u32 msecs);
 u32 timer_calc_usec(u32 usecs);
 int timer_check(u32 end);
+u32 timer_elapsed(u32 start);
+u32 timer_elapsed_usec(u32 start);
 void ndelay(u32 count);
 void udelay(u32 count);
 void mdelay(u32 count);
@@ -195,8 +204,31 @@ void usleep(u32 count);
 void msleep(u32 count);
 u32 ticks_to_ms(u32 ticks);
 u32 ticks_from_ms(u32 ms);
+#define SETTLE_USB_POSTPOWER        0
+#define SETTLE_USB_HUB_PWRGOOD      1
+#define SETTLE_USB_PORT_POLL        2
+#define SETTLE_USB_RESET_RECOVERY   3
+#define SETTLE_USB_SETADDR_RECOVERY 4
+#define SETTLE_ATA_RESET            5
+#define SETTLE_AHCI_COMRESET        6
+#define SETTLE_PS2_RESET            7
+#define SETTLE_FLOPPY_MOTOR         8
+#define SETTLE_FLOPPY_IRQ           9
+#define SETTLE_MAX                  10
+void settle_setup(void);
+u32 settle_time(int site, u32 hwtime);
+void settle_msleep(int site, u32 hwtime);
+void settle_mdelay(int site, u32 hwtime);
+void settle_report(void);
+void waitprof_setup(void);
+u32 waitprof_start(void);
+void waitprof_end(u32 start, const char *name, void *caller);
+void waitprof_report(void);
 void pit_setup(void);
 
+// ioprof.c
+void ioprof_report(void);
+
 // jpeg.c
 struct jpeg_decdata *jpeg_alloc(void);
 int jpeg_decode(struct jpeg_decdata *jpeg, unsigned char *buf);
@@ -250,11 +282,21 @@ void interface_init(void);
 void device_hardware_setup(void);
 void prepareboot(void);
 void startBoot(void);
+void *reloc_linkaddr(void *addr);
 void reloc_preinit(void *f, void *arg);
 void code_mutable_preinit(void);
 
+// sampleprof.c
+struct irqregs;
+void sampleprof_irq(struct irqregs *regs);
+void sampleprof_yield(void *caller);
+void sampleprof_enter(void);
+void sampleprof_setup(void);
+void sampleprof_report(void);
+
 // sercon.c
 void sercon_setup(void);
+void sercon_report(void);
 void sercon_check_event(void);
 
 // serial.c
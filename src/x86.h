@@ -12,14 +12,20 @@
 #define CR0_PG (1<<31) // Paging
 #define CR0_CD (1<<30) // Cache disable
 #define CR0_NW (1<<29) // Not Write-through
+#define CR0_TS (1<<3)  // Task switched
+#define CR0_EM (1<<2)  // Emulation
 #define CR0_PE (1<<0)  // Protection enable
 
+// CR4 flags
+#define CR4_OSFXSR (1<<9) // Enable fxsave/fxrstor and SSE
+
 // PORT_A20 bitdefs
 #define PORT_A20 0x0092
 #define A20_ENABLE_BIT 0x02
 
 #ifndef __ASSEMBLY__
 
+#include "config.h" // CONFIG_DEBUG_IOPROF
 #include "types.h" // u32
 
 static inline void irq_disable(void)
@@ -87,6 +93,14 @@ static inline void cr0_write(u32 cr0) {
 static inline void cr0_mask(u32 off, u32 on) {
     cr0_write((cr0_read() & ~off) | on);
 }
+static inline u32 cr4_read(void) {
+    u32 cr4;
+    asm("movl %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+static inline void cr4_write(u32 cr4) {
+    asm("movl %0, %%cr4" : : "r"(cr4));
+}
 static inline u16 cr0_vm86_read(void) {
     u16 cr0;
     asm("smsww %0" : "=r"(cr0));
@@ -147,53 +161,82 @@ static inline u32 ror(u32 val, u16 ror) {
     return res;
 }
 
-static inline void outb(u8 value, u16 port) {
+// Optional accounting of io accesses (see ioprof.c)
+#if CONFIG_DEBUG_IOPROF && !MODESEGMENT
+void __ioprof_port(u16 port, void *caller);
+void __ioprof_mmio(const void *addr, void *caller);
+// Address of the access itself.  The helpers below are always inlined
+// so that this identifies the code that performs the access.
+#define ioprof_site() ({                                        \
+        void *__site;                                           \
+        asm volatile("movl $1f, %0\n1:" : "=r"(__site));        \
+        __site; })
+#define ioprof_port(port) __ioprof_port((port), ioprof_site())
+#define ioprof_mmio(addr) __ioprof_mmio((addr), ioprof_site())
+#else
+#define ioprof_port(port) do { } while (0)
+#define ioprof_mmio(addr) do { } while (0)
+#endif
+
+static __always_inline void outb(u8 value, u16 port) {
+    ioprof_port(port);
     __asm__ __volatile__("outb %b0, %w1" : : "a"(value), "Nd"(port));
 }
-static inline void outw(u16 value, u16 port) {
+static __always_inline void outw(u16 value, u16 port) {
+    ioprof_port(port);
     __asm__ __volatile__("outw %w0, %w1" : : "a"(value), "Nd"(port));
 }
-static inline void outl(u32 value, u16 port) {
+static __always_inline void outl(u32 value, u16 port) {
+    ioprof_port(port);
     __asm__ __volatile__("outl %0, %w1" : : "a"(value), "Nd"(port));
 }
-static inline u8 inb(u16 port) {
+static __always_inline u8 inb(u16 port) {
+    ioprof_port(port);
     u8 value;
     __asm__ __volatile__("inb %w1, %b0" : "=a"(value) : "Nd"(port));
     return value;
 }
-static inline u16 inw(u16 port) {
+static __always_inline u16 inw(u16 port) {
+    ioprof_port(port);
     u16 value;
     __asm__ __volatile__("inw %w1, %w0" : "=a"(value) : "Nd"(port));
     return value;
 }
-static inline u32 inl(u16 port) {
+static __always_inline u32 inl(u16 port) {
+    ioprof_port(port);
     u32 value;
     __asm__ __volatile__("inl %w1, %0" : "=a"(value) : "Nd"(port));
     return value;
 }
 
-static inline void insb(u16 port, u8 *data, u32 count) {
+static __always_inline void insb(u16 port, u8 *data, u32 count) {
+    ioprof_port(port);
     asm volatile("rep insb (%%dx), %%es:(%%edi)"
                  : "+c"(count), "+D"(data) : "d"(port) : "memory");
 }
-static inline void insw(u16 port, u16 *data, u32 count) {
+static __always_inline void insw(u16 port, u16 *data, u32 count) {
+    ioprof_port(port);
     asm volatile("rep insw (%%dx), %%es:(%%edi)"
                  : "+c"(count), "+D"(data) : "d"(port) : "memory");
 }
-static inline void insl(u16 port, u32 *data, u32 count) {
+static __always_inline void insl(u16 port, u32 *data, u32 count) {
+    ioprof_port(port);
     asm volatile("rep insl (%%dx), %%es:(%%edi)"
                  : "+c"(count), "+D"(data) : "d"(port) : "memory");
 }
 // XXX - outs not limited to es segment
-static inline void outsb(u16 port, u8 *data, u32 count) {
+static __always_inline void outsb(u16 port, u8 *data, u32 count) {
+    ioprof_port(port);
     asm volatile("rep outsb %%es:(%%esi), (%%dx)"
                  : "+c"(count), "+S"(data) : "d"(port) : "memory");
 }
-static inline void outsw(u16 port, u16 *data, u32 count) {
+static __always_inline void outsw(u16 port, u16 *data, u32 count) {
+    ioprof_port(port);
     asm volatile("rep outsw %%es:(%%esi), (%%dx)"
                  : "+c"(count), "+S"(data) : "d"(port) : "memory");
 }
-static inline void outsl(u16 port, u32 *data, u32 count) {
+static __always_inline void outsl(u16 port, u32 *data, u32 count) {
+    ioprof_port(port);
     asm volatile("rep outsl %%es:(%%esi), (%%dx)"
                  : "+c"(count), "+S"(data) : "d"(port) : "memory");
 }
@@ -206,34 +249,41 @@ static inline void smp_wmb(void) {
     barrier();
 }
 
-static inline void writel(void *addr, u32 val) {
+static __always_inline void writel(void *addr, u32 val) {
+    ioprof_mmio(addr);
     barrier();
     *(volatile u32 *)addr = val;
 }
-static inline void writew(void *addr, u16 val) {
+static __always_inline void writew(void *addr, u16 val) {
+    ioprof_mmio(addr);
     barrier();
     *(volatile u16 *)addr = val;
 }
-static inline void writeb(void *addr, u8 val) {
+static __always_inline void writeb(void *addr, u8 val) {
+    ioprof_mmio(addr);
     barrier();
     *(volatile u8 *)addr = val;
 }
-static inline u64 readq(const void *addr) {
+static __always_inline u64 readq(const void *addr) {
+    ioprof_mmio(addr);
     u64 val = *(volatile const u64 *)addr;
     barrier();
     return val;
 }
-static inline u32 readl(const void *addr) {
+static __always_inline u32 readl(const void *addr) {
+    ioprof_mmio(addr);
     u32 val = *(volatile const u32 *)addr;
     barrier();
     return val;
 }
-static inline u16 readw(const void *addr) {
+static __always_inline u16 readw(const void *addr) {
+    ioprof_mmio(addr);
     u16 val = *(volatile const u16 *)addr;
     barrier();
     return val;
 }
-static inline u8 readb(const void *addr) {
+static __always_inline u8 readb(const void *addr) {
+    ioprof_mmio(addr);
     u8 val = *(volatile const u8 *)addr;
     barrier();
     return val;
@@ -264,6 +314,9 @@ static inline void sgdt(struct descloc_s *desc) {
 static inline void lgdt(struct descloc_s *desc) {
     asm("lgdtl %0" : : "m"(*desc) : "memory");
 }
+static inline void lidt(struct descloc_s *desc) {
+    asm("lidtl %0" : : "m"(*desc) : "memory");
+}
 
 static inline u8 get_a20(void) {
     return (inb(PORT_A20) & A20_ENABLE_BIT) != 0;